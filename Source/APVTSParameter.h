@@ -11,6 +11,7 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <vector>
 
 struct IAPVTSParameter
 {
@@ -90,18 +91,45 @@ struct APVTSParameterBool : public IAPVTSParameter
 struct APVTSParameterChoice : public IAPVTSParameter
 {
     juce::AudioParameterChoice* paramPointer;
+    std::vector<float> choiceValues;
 
     APVTSParameterChoice(const juce::String& stringID, const juce::String& val, float def)
         : IAPVTSParameter(stringID, val, def)
     {
     }
 
+    // Choice names are parsed once here so get() is a plain table lookup.
+    void castParameter(juce::AudioProcessorValueTreeState& apvts) override {
+        paramPointer = dynamic_cast<juce::AudioParameterChoice*>(apvts.getParameter(id.getParamID()));
+        jassert(paramPointer);
+
+        choiceValues.clear();
+        for (auto& choice : paramPointer->choices) {
+            choiceValues.push_back(choice.getFloatValue());
+        }
+    }
+
+    float get() const override {
+        return choiceValues[static_cast<size_t>(paramPointer->getIndex())];
+    }
+};
+
+// For choices that name modes rather than values: get() is the choice index.
+struct APVTSParameterChoiceIndex : public IAPVTSParameter
+{
+    juce::AudioParameterChoice* paramPointer;
+
+    APVTSParameterChoiceIndex(const juce::String& stringID, const juce::String& val, float def)
+        : IAPVTSParameter(stringID, val, def)
+    {
+    }
+
     void castParameter(juce::AudioProcessorValueTreeState& apvts) override {
         paramPointer = dynamic_cast<juce::AudioParameterChoice*>(apvts.getParameter(id.getParamID()));
         jassert(paramPointer);
     }
 
     float get() const override {
-        return paramPointer->getCurrentChoiceName().getFloatValue();
+        return static_cast<float>(paramPointer->getIndex());
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,352 @@
+/*
+  ==============================================================================
+
+    Analyzer.h
+    Spectrum analyzer: audio thread capture, background FFT and the lock-free
+    transport in between.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <vector>
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+using std::vector;
+
+#include "Utils.h"
+
+#define ANALYZER_POLL_MS 10
+#define ANALYZER_AVERAGE_MS 150.0f
+#define PEAK_FALL_DB_PER_SECOND 12.0f
+#define SPECTRUM_FLOOR_DB -120.0f
+
+constexpr int analyzerOrder = 12;
+constexpr int analyzerSize = 1 << analyzerOrder;
+constexpr int analyzerBins = analyzerSize / 2 + 1;
+constexpr int analyzerHop = analyzerSize / 4;
+
+// Wait-free ring for one producer and one consumer. push() drops whatever does
+// not fit instead of waiting for the reader.
+template <typename T>
+class SpscFifo
+{
+    vector<T> buffer;
+    uint32_t mask{ 0 };
+    std::atomic<uint32_t> writePosition{ 0 };
+    std::atomic<uint32_t> readPosition{ 0 };
+
+public:
+
+    // Rounds up to a power of two. Not thread safe: call while neither side runs.
+    void prepare(int capacity) {
+        auto size = static_cast<uint32_t>(juce::nextPowerOfTwo(std::max(2, capacity)));
+        buffer.assign(size, T{});
+        mask = size - 1;
+        writePosition.store(0);
+        readPosition.store(0);
+    }
+
+    // Consumer side.
+    int getNumReady() const {
+        return static_cast<int>(writePosition.load(std::memory_order_acquire) - readPosition.load(std::memory_order_relaxed));
+    }
+
+    int push(const T* data, int numItems) {
+        auto w = writePosition.load(std::memory_order_relaxed);
+        auto r = readPosition.load(std::memory_order_acquire);
+        auto n = std::min(numItems, static_cast<int>(mask + 1 - (w - r)));
+
+        for (int i = 0; i < n; ++i) buffer[(w + i) & mask] = data[i];
+
+        writePosition.store(w + n, std::memory_order_release);
+        return n;
+    }
+
+    int discard(int numItems) {
+        auto r = readPosition.load(std::memory_order_relaxed);
+        auto w = writePosition.load(std::memory_order_acquire);
+        auto n = std::min(numItems, static_cast<int>(w - r));
+
+        readPosition.store(r + n, std::memory_order_release);
+        return n;
+    }
+
+    int pop(T* dest, int numItems) {
+        auto r = readPosition.load(std::memory_order_relaxed);
+        auto w = writePosition.load(std::memory_order_acquire);
+        auto n = std::min(numItems, static_cast<int>(w - r));
+
+        for (int i = 0; i < n; ++i) dest[i] = buffer[(r + i) & mask];
+
+        readPosition.store(r + n, std::memory_order_release);
+        return n;
+    }
+};
+
+// Latest-value handoff from one writer to one reader. The writer fills its back
+// buffer and publishes it; the reader swaps in the newest published buffer.
+// Neither ever waits, and a slow reader only skips values.
+template <typename T>
+class TripleBuffer
+{
+    static constexpr int fresh = 4;
+    static constexpr int indexMask = 3;
+
+    std::array<T, 3> buffers{};
+    std::atomic<int> middle{ 1 };
+    int back{ 0 };
+    int front{ 2 };
+
+public:
+
+    T& getWriteBuffer() {
+        return buffers[back];
+    }
+
+    void publish() {
+        back = middle.exchange(back | fresh, std::memory_order_acq_rel) & indexMask;
+    }
+
+    // True if a newer value was swapped in.
+    bool update() {
+        if ((middle.load(std::memory_order_relaxed) & fresh) == 0) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+
+    const T& read() const {
+        return buffers[front];
+    }
+};
+
+// One sample of the mono mix before and after the compressor.
+struct AnalyzerFrame
+{
+    float input{ 0.0f };
+    float output{ 0.0f };
+};
+
+// Averaged spectra in dB for bins 0 .. analyzerSize / 2; 0 dB is a full scale sine.
+// Starts at the floor, so nothing is drawn before the first analysis.
+struct Spectrum
+{
+    std::array<float, analyzerBins> input{};
+    std::array<float, analyzerBins> output{};
+    std::array<float, analyzerBins> outputPeak{};
+    float sampleRate{ 44100.0f };
+
+    Spectrum() {
+        input.fill(SPECTRUM_FLOOR_DB);
+        output.fill(SPECTRUM_FLOOR_DB);
+        outputPeak.fill(SPECTRUM_FLOOR_DB);
+    }
+};
+
+// The audio thread only mixes the channels down and pushes frames into the
+// FIFO, and only while a display is open. A worker thread, also only running
+// while a display is open, runs the windowed FFTs (75% overlap), averages the
+// power per bin, holds the output peaks and publishes the result through a
+// triple buffer for the GUI.
+class SpectrumAnalyzer : private juce::Thread
+{
+    SpscFifo<AnalyzerFrame> fifo;
+    TripleBuffer<Spectrum> spectra;
+    std::atomic<bool> active{ false };
+
+    // Audio thread.
+    vector<AnalyzerFrame> frames;
+    int capturedSamples{ 0 };
+
+    // Worker.
+    juce::dsp::FFT fft{ analyzerOrder };
+    vector<float> window;
+    vector<AnalyzerFrame> history;
+    vector<float> scratch;
+    vector<float> inputPower;
+    vector<float> outputPower;
+    vector<float> peakDb;
+    float sampleRate{ 44100.0f };
+    float smoothing{ 1.0f };
+    float peakFall{ 0.0f };
+
+    static float powerToDb(float power) {
+        return std::max(SPECTRUM_FLOOR_DB, 10.0f * std::log10(power + 1.0e-12f));
+    }
+
+    template <typename Select>
+    void accumulate(Select select, vector<float>& power) {
+        std::fill(scratch.begin(), scratch.end(), 0.0f);
+        for (int i = 0; i < analyzerSize; ++i) scratch[i] = select(history[i]) * window[i];
+
+        fft.performFrequencyOnlyForwardTransform(scratch.data());
+
+        for (int bin = 0; bin < analyzerBins; ++bin) {
+            power[bin] += (scratch[bin] * scratch[bin] - power[bin]) * smoothing;
+        }
+    }
+
+    void publish() {
+        auto& spectrum = spectra.getWriteBuffer();
+        spectrum.sampleRate = sampleRate;
+
+        for (int bin = 0; bin < analyzerBins; ++bin) {
+            spectrum.input[bin] = powerToDb(inputPower[bin]);
+            spectrum.output[bin] = powerToDb(outputPower[bin]);
+            spectrum.outputPeak[bin] = peakDb[bin];
+        }
+
+        spectra.publish();
+    }
+
+    void run() override {
+        while (!threadShouldExit()) {
+            auto ready = fifo.getNumReady();
+            if (ready < analyzerHop) {
+                wait(ANALYZER_POLL_MS);
+                continue;
+            }
+
+            // When behind, only the newest window matters for the display.
+            auto hops = ready / analyzerHop;
+            auto maxHops = analyzerSize / analyzerHop;
+            if (hops > maxHops) {
+                fifo.discard((hops - maxHops) * analyzerHop);
+                hops = maxHops;
+            }
+
+            for (int h = 0; h < hops; ++h) {
+                std::copy(history.begin() + analyzerHop, history.end(), history.begin());
+                fifo.pop(history.data() + analyzerSize - analyzerHop, analyzerHop);
+
+                accumulate([](const AnalyzerFrame& f) { return f.input; }, inputPower);
+                accumulate([](const AnalyzerFrame& f) { return f.output; }, outputPower);
+
+                for (int bin = 0; bin < analyzerBins; ++bin) {
+                    peakDb[bin] = std::max(powerToDb(outputPower[bin]), peakDb[bin] - peakFall);
+                }
+            }
+
+            publish();
+        }
+    }
+
+    // Clears the averages and publishes an empty spectrum. Only while the
+    // worker is stopped.
+    void clear() {
+        fifo.discard(fifo.getNumReady());
+        std::fill(history.begin(), history.end(), AnalyzerFrame{});
+        std::fill(inputPower.begin(), inputPower.end(), 0.0f);
+        std::fill(outputPower.begin(), outputPower.end(), 0.0f);
+        std::fill(peakDb.begin(), peakDb.end(), SPECTRUM_FLOOR_DB);
+        publish();
+    }
+
+public:
+
+    SpectrumAnalyzer() : juce::Thread("Spectrum Analyzer") {
+        // Hann, scaled so a full scale sine reads 0 dB.
+        window.resize(analyzerSize);
+        double sum = 0.0;
+        for (int i = 0; i < analyzerSize; ++i) {
+            window[i] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * i / analyzerSize);
+            sum += window[i];
+        }
+        for (auto& w : window) w *= static_cast<float>(2.0 / sum);
+
+        history.assign(analyzerSize, AnalyzerFrame{});
+        scratch.assign(2 * analyzerSize, 0.0f);
+        inputPower.assign(analyzerBins, 0.0f);
+        outputPower.assign(analyzerBins, 0.0f);
+        peakDb.assign(analyzerBins, SPECTRUM_FLOOR_DB);
+    }
+
+    ~SpectrumAnalyzer() override {
+        stopThread(1000);
+    }
+
+    // Not real time safe; restarts the worker, if a display is open, with
+    // cleared averages.
+    void prepare(double sr, int maxBlockSize) {
+        stopThread(1000);
+
+        sampleRate = static_cast<float>(sr);
+        frames.assign(std::max(1, maxBlockSize), AnalyzerFrame{});
+        fifo.prepare(std::max(static_cast<int>(nearestPowerOfTwo(static_cast<int>(sr / 2))), 4 * maxBlockSize));
+
+        auto hopSeconds = analyzerHop / sampleRate;
+        smoothing = 1.0f - std::exp(-hopSeconds * 1000.0f / ANALYZER_AVERAGE_MS);
+        peakFall = PEAK_FALL_DB_PER_SECOND * hopSeconds;
+
+        clear();
+        if (active.load()) startThread();
+    }
+
+    void release() {
+        stopThread(1000);
+    }
+
+    // Displays switch capture and the worker on while they are open, from
+    // the message thread. Each opening starts from cleared averages.
+    void setActive(bool shouldCapture) {
+        if (shouldCapture == active.load()) return;
+
+        if (!shouldCapture) {
+            active.store(false, std::memory_order_relaxed);
+            stopThread(1000);
+            return;
+        }
+
+        clear();
+        active.store(true, std::memory_order_relaxed);
+        startThread();
+    }
+
+    // Audio thread: mono mix of the block before processing. Blocks longer than
+    // the prepared size are only analysed in part.
+    template <typename SampleType>
+    void captureInput(const SampleType* const* channels, int numChannels, int numSamples) {
+        capturedSamples = 0;
+        if (!active.load(std::memory_order_relaxed) || numChannels <= 0) return;
+
+        capturedSamples = std::min(numSamples, static_cast<int>(frames.size()));
+        auto gain = 1.0f / static_cast<float>(numChannels);
+
+        for (int s = 0; s < capturedSamples; ++s) frames[s].input = static_cast<float>(channels[0][s]);
+        for (int ch = 1; ch < numChannels; ++ch)
+            for (int s = 0; s < capturedSamples; ++s) frames[s].input += static_cast<float>(channels[ch][s]);
+        for (int s = 0; s < capturedSamples; ++s) frames[s].input *= gain;
+    }
+
+    // Audio thread: the same after processing, then hands both to the worker.
+    template <typename SampleType>
+    void captureOutput(const SampleType* const* channels, int numChannels, int numSamples) {
+        auto n = std::min(capturedSamples, numSamples);
+        if (n == 0) return;
+
+        auto gain = 1.0f / static_cast<float>(numChannels);
+
+        for (int s = 0; s < n; ++s) frames[s].output = static_cast<float>(channels[0][s]);
+        for (int ch = 1; ch < numChannels; ++ch)
+            for (int s = 0; s < n; ++s) frames[s].output += static_cast<float>(channels[ch][s]);
+        for (int s = 0; s < n; ++s) frames[s].output *= gain;
+
+        fifo.push(frames.data(), n);
+    }
+
+    // Read side for a single GUI consumer.
+    TripleBuffer<Spectrum>& getSpectra() {
+        return spectra;
+    }
+};
+
+#undef ANALYZER_POLL_MS
+#undef ANALYZER_AVERAGE_MS
+#undef PEAK_FALL_DB_PER_SECOND
+#undef SPECTRUM_FLOOR_DB
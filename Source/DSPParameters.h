@@ -1,27 +1,123 @@
 #pragma once
 
-#include <unordered_map>
-#include <string>
-using std::unordered_map;
-using std::string;
+#include <array>
+#include <atomic>
+#include <cstdint>
 
+// Largest band count the engine can be built with.
+constexpr int maxBands = 8;
+
+// Band count of the plugin build; the parameter layout is generated from it.
+#ifndef TRIO_NUM_BANDS
+ #define TRIO_NUM_BANDS 3
+#endif
+
+constexpr int numBands = TRIO_NUM_BANDS;
+static_assert(numBands >= 2 && numBands <= maxBands, "TRIO_NUM_BANDS must be between 2 and 8");
+
+// Per-band parameters are laid out kind-major with room for maxBands bands, so
+// the entry for band b is KIND + b whatever the band count, and crossover i
+// (between bands i and i + 1) is CROSSOVER + i. Entries past the build's band
+// count are never written.
+enum ParameterNames
+{
+    THRESHOLD    = 0,
+    RATIO        = THRESHOLD + maxBands,
+    ATTACK       = RATIO + maxBands,
+    RELEASE      = ATTACK + maxBands,
+    BAND_INPUT   = RELEASE + maxBands,
+    BAND_OUTPUT  = BAND_INPUT + maxBands,
+    MUTE         = BAND_OUTPUT + maxBands,
+    OVERSAMPLING = MUTE + maxBands,
+    LOOKAHEAD    = OVERSAMPLING + maxBands,
+    DETECTOR     = LOOKAHEAD + maxBands,
+    RMS_WINDOW   = DETECTOR + maxBands,
+    KNEE         = RMS_WINDOW + maxBands,
+    CROSSOVER    = KNEE + maxBands,
+    INPUT_ALL    = CROSSOVER + maxBands - 1,
+    OUTPUT_ALL,
+    BYPASS,
+    LINK_MODE,
+    CROSSOVER_MODE,
+    PARAMETER_COUNT
+};
+
+// Default crossover frequencies, lowest first, for each band count.
+inline float defaultCrossoverFrequency(int bands, int index) {
+    static constexpr float defaults[maxBands - 1][maxBands - 1] = {
+        { 1000.0f },
+        { 700.0f, 5000.0f },
+        { 200.0f, 1000.0f, 5000.0f },
+        { 120.0f, 500.0f, 2000.0f, 6000.0f },
+        { 100.0f, 300.0f, 1000.0f, 3000.0f, 8000.0f },
+        { 80.0f, 200.0f, 500.0f, 1200.0f, 3000.0f, 8000.0f },
+        { 60.0f, 150.0f, 350.0f, 800.0f, 1800.0f, 4000.0f, 9000.0f }
+    };
+    return defaults[bands - 2][index];
+}
+
+constexpr int parameterMaskWords = (PARAMETER_COUNT + 63) / 64;
+
+// Fixed-size parameter table indexed by ParameterNames. Owned and read by the
+// audio thread only: the dirty mask tells the engine which entries changed
+// since the last clearDirty(), so it can skip everything else.
 template <typename T>
 class DSPParameters
 {
+    std::array<T, PARAMETER_COUNT> values{};
+    std::array<uint64_t, parameterMaskWords> dirty{};
+
 public:
-    unordered_map<string, T> parameters;
 
-    T operator[] (string key) {
-        if (parameters.find(key) != parameters.end()) {
-            return parameters[key];
+    T operator[] (int index) const {
+        return values[index];
+    }
+
+    void set(int index, T value) {
+        values[index] = value;
+        dirty[index >> 6] |= uint64_t(1) << (index & 63);
+    }
+
+    bool isDirty(int index) const {
+        return (dirty[index >> 6] >> (index & 63)) & 1;
+    }
+
+    bool anyDirty() const {
+        for (auto word : dirty) {
+            if (word != 0) return true;
         }
-        else {
-            return 1.0f;
+        return false;
+    }
+
+    void markAllDirty() {
+        for (int i = 0; i < PARAMETER_COUNT; ++i) {
+            dirty[i >> 6] |= uint64_t(1) << (i & 63);
         }
     }
 
-    void set(string key, T value) {
-        parameters[key] = value;
+    void clearDirty() {
+        dirty.fill(0);
+    }
+};
+
+// Set of parameter indices changed since the audio thread last looked.
+// mark() is wait-free and may be called from any thread (parameter listeners);
+// take() is called on the audio thread.
+class ParameterChanges
+{
+    std::array<std::atomic<uint64_t>, parameterMaskWords> pending{};
+
+public:
+
+    void mark(int index) {
+        pending[index >> 6].fetch_or(uint64_t(1) << (index & 63), std::memory_order_release);
+    }
+
+    void markAll() {
+        for (int i = 0; i < PARAMETER_COUNT; ++i) mark(i);
     }
 
-};
\ No newline at end of file
+    uint64_t take(int word) {
+        return pending[word].exchange(0, std::memory_order_acquire);
+    }
+};
@@ -0,0 +1,716 @@
+/*
+  ==============================================================================
+
+    Dispatch.h
+
+    The engine's crossover, detector and summing kernels, built for several
+    instruction sets; one set is picked at run time. The baseline set is what
+    the build targets: SSE2 on x86, NEON on ARM. On x86 the AVX2 (with FMA)
+    and AVX-512 sets are compiled next to it with per-function targets, so the
+    binary still runs on any SSE2 machine.
+
+    The wide sets fit several frames of a lane group, or the same frame of
+    several lane groups, into one register. Their output agrees with the
+    baseline to within float rounding: FMA rounds once where the baseline
+    rounds twice.
+
+    The widest set the CPU has is used unless the TRIO_ISA environment
+    variable, or MultibandCompressor::setInstructionSet(), names another
+    ("sse2", "neon", "avx2" or "avx512"). A set the CPU lacks falls back to
+    the widest one below it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <iterator>
+
+#include "Utils.h"
+#include "FastMath.h"
+#include "Filters.h"
+
+enum class InstructionSet { automatic, baseline, avx2, avx512 };
+
+// Frame kernels work on numFrames frames of simdLanes floats, one lane
+// group's worth per sample, with ramps holding one value per frame. The
+// crossover kernels run groups lane groups from firstGroup on, whose blocks
+// lie stride frames apart in the sample buffers.
+struct EngineKernels
+{
+    InstructionSet instructionSet;
+
+    void (*linearToDb)(const float* in, float* out, int numValues);
+    void (*dbToLinear)(const float* in, float* out, int numValues);
+
+    void (*hardKnee)(const SIMDFloat* level, const float* threshold, const float* slope, SIMDFloat* gain, int numFrames);
+    void (*softKnee)(const SIMDFloat* level, const float* threshold, const float* slope,
+                     const float* knee, const float* curvature, SIMDFloat* gain, int numFrames);
+
+    // data *= ramp
+    void (*scale)(SIMDFloat* data, const float* ramp, int numFrames);
+    // data *= gains, then *= ramp unless it is nullptr
+    void (*multiply)(SIMDFloat* data, const SIMDFloat* gains, const float* ramp, int numFrames);
+    // sum += data * ramp
+    void (*accumulate)(SIMDFloat* sum, const SIMDFloat* data, const float* ramp, int numFrames);
+    // dry = dry * (1 - wetRamp) + wet * (gainRamp * wetRamp)
+    void (*mix)(SIMDFloat* dry, const SIMDFloat* wet, const float* wetRamp, const float* gainRamp, int numFrames);
+
+    void (*split)(LRFilter<SIMDFloat>& filter, int firstGroup, int groups, int stride,
+                  const SIMDFloat* input, SIMDFloat* low, SIMDFloat* high, int numSamples);
+    // In place.
+    void (*allpass)(LRFilter<SIMDFloat>& filter, int firstGroup, int groups, int stride, SIMDFloat* data, int numSamples);
+};
+
+struct BaselineKernels
+{
+    static void linearToDb(const float* in, float* out, int numValues) {
+        linearToDbBlock(in, out, numValues);
+    }
+
+    static void dbToLinear(const float* in, float* out, int numValues) {
+        dbToLinearBlock(in, out, numValues);
+    }
+
+    static void hardKnee(const SIMDFloat* level, const float* threshold, const float* slope, SIMDFloat* gain, int numFrames) {
+        auto* in = toFloatPointer(level);
+        auto* out = toFloatPointer(gain);
+        for (int s = 0; s < numFrames; ++s) {
+            for (int l = 0; l < simdLanes; ++l) {
+                auto i = s * simdLanes + l;
+                out[i] = std::max(in[i] - threshold[s], 0.0f) * slope[s];
+            }
+        }
+    }
+
+    static void softKnee(const SIMDFloat* level, const float* threshold, const float* slope,
+                         const float* knee, const float* curvature, SIMDFloat* gain, int numFrames) {
+        auto* in = toFloatPointer(level);
+        auto* out = toFloatPointer(gain);
+        for (int s = 0; s < numFrames; ++s) {
+            auto half = 0.5f * knee[s];
+            for (int l = 0; l < simdLanes; ++l) {
+                auto i = s * simdLanes + l;
+                auto excess = in[i] - threshold[s];
+                auto inKnee = juce::jlimit(0.0f, knee[s], excess + half);
+                out[i] = (inKnee * inKnee * curvature[s] + std::max(excess - half, 0.0f)) * slope[s];
+            }
+        }
+    }
+
+    static void scale(SIMDFloat* data, const float* ramp, int numFrames) {
+        for (int s = 0; s < numFrames; ++s) data[s] = data[s] * ramp[s];
+    }
+
+    static void multiply(SIMDFloat* data, const SIMDFloat* gains, const float* ramp, int numFrames) {
+        if (ramp == nullptr) {
+            for (int s = 0; s < numFrames; ++s) data[s] = data[s] * gains[s];
+        }
+        else {
+            for (int s = 0; s < numFrames; ++s) data[s] = data[s] * gains[s] * ramp[s];
+        }
+    }
+
+    static void accumulate(SIMDFloat* sum, const SIMDFloat* data, const float* ramp, int numFrames) {
+        for (int s = 0; s < numFrames; ++s) sum[s] = sum[s] + data[s] * ramp[s];
+    }
+
+    static void mix(SIMDFloat* dry, const SIMDFloat* wet, const float* wetRamp, const float* gainRamp, int numFrames) {
+        for (int s = 0; s < numFrames; ++s) {
+            dry[s] = dry[s] * (1.0f - wetRamp[s]) + wet[s] * (gainRamp[s] * wetRamp[s]);
+        }
+    }
+
+    static void split(LRFilter<SIMDFloat>& filter, int firstGroup, int groups, int stride,
+                      const SIMDFloat* input, SIMDFloat* low, SIMDFloat* high, int numSamples) {
+        for (int group = 0; group < groups; ++group) {
+            auto offset = group * stride;
+            filter.processBlock(firstGroup + group, input + offset, low + offset, high + offset, numSamples);
+        }
+    }
+
+    static void allpass(LRFilter<SIMDFloat>& filter, int firstGroup, int groups, int stride, SIMDFloat* data, int numSamples) {
+        for (int group = 0; group < groups; ++group) {
+            auto* block = data + group * stride;
+            filter.processAllpass(firstGroup + group, block, block, numSamples);
+        }
+    }
+};
+
+#if TRIO_WIDE_KERNELS
+
+static_assert(simdLanes == 4 || simdLanes == 8, "The wide kernels expect lane groups of four or eight floats");
+
+// A register holds this many frames of one lane group, or the same frame of
+// this many lane groups.
+constexpr int avx2Frames = 8 / simdLanes;
+constexpr int avx512Frames = 16 / simdLanes;
+
+// One ramp value per frame, spread over the lanes of its frame.
+TRIO_TARGET_AVX2 inline __m256 loadRampAvx2(const float* ramp) {
+    if constexpr (avx2Frames == 1) return _mm256_set1_ps(ramp[0]);
+    else return _mm256_insertf128_ps(_mm256_set1_ps(ramp[0]), _mm_set1_ps(ramp[1]), 1);
+}
+
+TRIO_TARGET_AVX512 inline __m512 loadRampAvx512(const float* ramp) {
+    const auto lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const auto frames = _mm512_srli_epi32(lanes, simdLanes == 4 ? 2 : 3);
+
+    __m128 values;
+    if constexpr (avx512Frames == 4) values = _mm_loadu_ps(ramp);
+    else values = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(ramp)));
+
+    return _mm512_permutexvar_ps(frames, _mm512_castps128_ps512(values));
+}
+
+// The same frame of consecutive lane groups, stride floats apart.
+TRIO_TARGET_AVX2 inline __m256 loadGroupsAvx2(const float* data, int stride) {
+    if constexpr (avx2Frames == 1) return _mm256_loadu_ps(data);
+    else return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(data)), _mm_loadu_ps(data + stride), 1);
+}
+
+TRIO_TARGET_AVX2 inline void storeGroupsAvx2(float* data, int stride, __m256 v) {
+    if constexpr (avx2Frames == 1) {
+        _mm256_storeu_ps(data, v);
+    }
+    else {
+        _mm_storeu_ps(data, _mm256_castps256_ps128(v));
+        _mm_storeu_ps(data + stride, _mm256_extractf128_ps(v, 1));
+    }
+}
+
+TRIO_TARGET_AVX512 inline __m512 loadGroupsAvx512(const float* data, int stride) {
+    if constexpr (avx512Frames == 2) {
+        auto first = _mm256_castps_pd(_mm256_loadu_ps(data));
+        auto second = _mm256_castps_pd(_mm256_loadu_ps(data + stride));
+        return _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castpd256_pd512(first), second, 1));
+    }
+    else {
+        auto v = _mm512_castps128_ps512(_mm_loadu_ps(data));
+        v = _mm512_insertf32x4(v, _mm_loadu_ps(data + stride), 1);
+        v = _mm512_insertf32x4(v, _mm_loadu_ps(data + 2 * stride), 2);
+        return _mm512_insertf32x4(v, _mm_loadu_ps(data + 3 * stride), 3);
+    }
+}
+
+TRIO_TARGET_AVX512 inline void storeGroupsAvx512(float* data, int stride, __m512 v) {
+    if constexpr (avx512Frames == 2) {
+        _mm256_storeu_ps(data, _mm256_castpd_ps(_mm512_castpd512_pd256(_mm512_castps_pd(v))));
+        _mm256_storeu_ps(data + stride, _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1)));
+    }
+    else {
+        _mm_storeu_ps(data, _mm512_castps512_ps128(v));
+        _mm_storeu_ps(data + stride, _mm512_extractf32x4_ps(v, 1));
+        _mm_storeu_ps(data + 2 * stride, _mm512_extractf32x4_ps(v, 2));
+        _mm_storeu_ps(data + 3 * stride, _mm512_extractf32x4_ps(v, 3));
+    }
+}
+
+// LRFilter::tick() and allpassTick() on whole registers; r2g is R2 + g.
+TRIO_TARGET_AVX2 inline void splitTickAvx2(__m256 x, __m256& low, __m256& high, __m256 gc, __m256 hc, __m256 r2, __m256 r2g,
+                                           __m256& z1, __m256& z2, __m256& z3, __m256& z4) {
+    auto yH = _mm256_mul_ps(_mm256_sub_ps(_mm256_fnmadd_ps(z1, r2g, x), z2), hc);
+    auto yB = _mm256_fmadd_ps(yH, gc, z1);
+    z1 = _mm256_fmadd_ps(yH, gc, yB);
+    auto yL = _mm256_fmadd_ps(yB, gc, z2);
+    z2 = _mm256_fmadd_ps(yB, gc, yL);
+
+    auto yH2 = _mm256_mul_ps(_mm256_sub_ps(_mm256_fnmadd_ps(z3, r2g, yL), z4), hc);
+    auto yB2 = _mm256_fmadd_ps(yH2, gc, z3);
+    z3 = _mm256_fmadd_ps(yH2, gc, yB2);
+    auto yL2 = _mm256_fmadd_ps(yB2, gc, z4);
+    z4 = _mm256_fmadd_ps(yB2, gc, yL2);
+
+    low = yL2;
+    high = _mm256_sub_ps(_mm256_add_ps(_mm256_fnmadd_ps(yB, r2, yL), yH), yL2);
+}
+
+TRIO_TARGET_AVX2 inline __m256 allpassTickAvx2(__m256 x, __m256 gc, __m256 hc, __m256 r2, __m256 r2g, __m256& z1, __m256& z2) {
+    auto yH = _mm256_mul_ps(_mm256_sub_ps(_mm256_fnmadd_ps(z1, r2g, x), z2), hc);
+    auto yB = _mm256_fmadd_ps(yH, gc, z1);
+    z1 = _mm256_fmadd_ps(yH, gc, yB);
+    auto yL = _mm256_fmadd_ps(yB, gc, z2);
+    z2 = _mm256_fmadd_ps(yB, gc, yL);
+
+    return _mm256_add_ps(_mm256_fnmadd_ps(yB, r2, yL), yH);
+}
+
+TRIO_TARGET_AVX512 inline void splitTickAvx512(__m512 x, __m512& low, __m512& high, __m512 gc, __m512 hc, __m512 r2, __m512 r2g,
+                                               __m512& z1, __m512& z2, __m512& z3, __m512& z4) {
+    auto yH = _mm512_mul_ps(_mm512_sub_ps(_mm512_fnmadd_ps(z1, r2g, x), z2), hc);
+    auto yB = _mm512_fmadd_ps(yH, gc, z1);
+    z1 = _mm512_fmadd_ps(yH, gc, yB);
+    auto yL = _mm512_fmadd_ps(yB, gc, z2);
+    z2 = _mm512_fmadd_ps(yB, gc, yL);
+
+    auto yH2 = _mm512_mul_ps(_mm512_sub_ps(_mm512_fnmadd_ps(z3, r2g, yL), z4), hc);
+    auto yB2 = _mm512_fmadd_ps(yH2, gc, z3);
+    z3 = _mm512_fmadd_ps(yH2, gc, yB2);
+    auto yL2 = _mm512_fmadd_ps(yB2, gc, z4);
+    z4 = _mm512_fmadd_ps(yB2, gc, yL2);
+
+    low = yL2;
+    high = _mm512_sub_ps(_mm512_add_ps(_mm512_fnmadd_ps(yB, r2, yL), yH), yL2);
+}
+
+TRIO_TARGET_AVX512 inline __m512 allpassTickAvx512(__m512 x, __m512 gc, __m512 hc, __m512 r2, __m512 r2g, __m512& z1, __m512& z2) {
+    auto yH = _mm512_mul_ps(_mm512_sub_ps(_mm512_fnmadd_ps(z1, r2g, x), z2), hc);
+    auto yB = _mm512_fmadd_ps(yH, gc, z1);
+    z1 = _mm512_fmadd_ps(yH, gc, yB);
+    auto yL = _mm512_fmadd_ps(yB, gc, z2);
+    z2 = _mm512_fmadd_ps(yB, gc, yL);
+
+    return _mm512_add_ps(_mm512_fnmadd_ps(yB, r2, yL), yH);
+}
+
+// Whole registers first; what is left over goes to the next narrower set.
+struct Avx2Kernels
+{
+    TRIO_TARGET_AVX2 static void linearToDb(const float* in, float* out, int numValues) {
+        linearToDbBlockAvx2(in, out, numValues);
+    }
+
+    TRIO_TARGET_AVX2 static void dbToLinear(const float* in, float* out, int numValues) {
+        dbToLinearBlockAvx2(in, out, numValues);
+    }
+
+    TRIO_TARGET_AVX2 static void hardKnee(const SIMDFloat* level, const float* threshold, const float* slope, SIMDFloat* gain, int numFrames) {
+        auto* in = toFloatPointer(level);
+        auto* out = toFloatPointer(gain);
+        const auto zero = _mm256_setzero_ps();
+
+        int s = 0;
+        for (; s + avx2Frames <= numFrames; s += avx2Frames) {
+            auto excess = _mm256_sub_ps(_mm256_loadu_ps(in + s * simdLanes), loadRampAvx2(threshold + s));
+            _mm256_storeu_ps(out + s * simdLanes, _mm256_mul_ps(_mm256_max_ps(excess, zero), loadRampAvx2(slope + s)));
+        }
+        BaselineKernels::hardKnee(level + s, threshold + s, slope + s, gain + s, numFrames - s);
+    }
+
+    TRIO_TARGET_AVX2 static void softKnee(const SIMDFloat* level, const float* threshold, const float* slope,
+                                          const float* knee, const float* curvature, SIMDFloat* gain, int numFrames) {
+        auto* in = toFloatPointer(level);
+        auto* out = toFloatPointer(gain);
+        const auto zero = _mm256_setzero_ps();
+        const auto half = _mm256_set1_ps(0.5f);
+
+        int s = 0;
+        for (; s + avx2Frames <= numFrames; s += avx2Frames) {
+            auto width = loadRampAvx2(knee + s);
+            auto halfWidth = _mm256_mul_ps(half, width);
+            auto excess = _mm256_sub_ps(_mm256_loadu_ps(in + s * simdLanes), loadRampAvx2(threshold + s));
+            auto inKnee = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(excess, halfWidth), zero), width);
+            auto above = _mm256_max_ps(_mm256_sub_ps(excess, halfWidth), zero);
+            auto db = _mm256_fmadd_ps(_mm256_mul_ps(inKnee, inKnee), loadRampAvx2(curvature + s), above);
+            _mm256_storeu_ps(out + s * simdLanes, _mm256_mul_ps(db, loadRampAvx2(slope + s)));
+        }
+        BaselineKernels::softKnee(level + s, threshold + s, slope + s, knee + s, curvature + s, gain + s, numFrames - s);
+    }
+
+    TRIO_TARGET_AVX2 static void scale(SIMDFloat* data, const float* ramp, int numFrames) {
+        auto* p = toFloatPointer(data);
+
+        int s = 0;
+        for (; s + avx2Frames <= numFrames; s += avx2Frames) {
+            auto* frame = p + s * simdLanes;
+            _mm256_storeu_ps(frame, _mm256_mul_ps(_mm256_loadu_ps(frame), loadRampAvx2(ramp + s)));
+        }
+        BaselineKernels::scale(data + s, ramp + s, numFrames - s);
+    }
+
+    TRIO_TARGET_AVX2 static void multiply(SIMDFloat* data, const SIMDFloat* gains, const float* ramp, int numFrames) {
+        auto* p = toFloatPointer(data);
+        auto* g = toFloatPointer(gains);
+
+        int s = 0;
+        if (ramp == nullptr) {
+            for (; s + avx2Frames <= numFrames; s += avx2Frames) {
+                auto i = s * simdLanes;
+                _mm256_storeu_ps(p + i, _mm256_mul_ps(_mm256_loadu_ps(p + i), _mm256_loadu_ps(g + i)));
+            }
+        }
+        else {
+            for (; s + avx2Frames <= numFrames; s += avx2Frames) {
+                auto i = s * simdLanes;
+                auto gained = _mm256_mul_ps(_mm256_loadu_ps(p + i), _mm256_loadu_ps(g + i));
+                _mm256_storeu_ps(p + i, _mm256_mul_ps(gained, loadRampAvx2(ramp + s)));
+            }
+        }
+        BaselineKernels::multiply(data + s, gains + s, ramp != nullptr ? ramp + s : nullptr, numFrames - s);
+    }
+
+    TRIO_TARGET_AVX2 static void accumulate(SIMDFloat* sum, const SIMDFloat* data, const float* ramp, int numFrames) {
+        auto* out = toFloatPointer(sum);
+        auto* in = toFloatPointer(data);
+
+        int s = 0;
+        for (; s + avx2Frames <= numFrames; s += avx2Frames) {
+            auto i = s * simdLanes;
+            _mm256_storeu_ps(out + i, _mm256_fmadd_ps(_mm256_loadu_ps(in + i), loadRampAvx2(ramp + s), _mm256_loadu_ps(out + i)));
+        }
+        BaselineKernels::accumulate(sum + s, data + s, ramp + s, numFrames - s);
+    }
+
+    TRIO_TARGET_AVX2 static void mix(SIMDFloat* dry, const SIMDFloat* wet, const float* wetRamp, const float* gainRamp, int numFrames) {
+        auto* out = toFloatPointer(dry);
+        auto* in = toFloatPointer(wet);
+        const auto one = _mm256_set1_ps(1.0f);
+
+        int s = 0;
+        for (; s + avx2Frames <= numFrames; s += avx2Frames) {
+            auto i = s * simdLanes;
+            auto share = loadRampAvx2(wetRamp + s);
+            auto wetGain = _mm256_mul_ps(loadRampAvx2(gainRamp + s), share);
+            auto dryPart = _mm256_mul_ps(_mm256_loadu_ps(out + i), _mm256_sub_ps(one, share));
+            _mm256_storeu_ps(out + i, _mm256_fmadd_ps(_mm256_loadu_ps(in + i), wetGain, dryPart));
+        }
+        BaselineKernels::mix(dry + s, wet + s, wetRamp + s, gainRamp + s, numFrames - s);
+    }
+
+    // avx2Frames lane groups from firstGroup on.
+    TRIO_TARGET_AVX2 static void splitGroups(LRFilter<SIMDFloat>& filter, int firstGroup, int stride,
+                                             const SIMDFloat* input, SIMDFloat* low, SIMDFloat* high, int numSamples) {
+        auto* states = toFloatPointer(filter.s1.data() + firstGroup);
+        auto* states2 = toFloatPointer(filter.s2.data() + firstGroup);
+        auto* states3 = toFloatPointer(filter.s3.data() + firstGroup);
+        auto* states4 = toFloatPointer(filter.s4.data() + firstGroup);
+        auto z1 = _mm256_loadu_ps(states), z2 = _mm256_loadu_ps(states2);
+        auto z3 = _mm256_loadu_ps(states3), z4 = _mm256_loadu_ps(states4);
+
+        auto* in = toFloatPointer(input);
+        auto* outLow = toFloatPointer(low);
+        auto* outHigh = toFloatPointer(high);
+        auto floatStride = stride * simdLanes;
+
+        const auto r2 = _mm256_set1_ps(filter.R2);
+        auto ramped = filter.rampActive;
+        auto* gs = filter.gRamp.data();
+        auto* hs = filter.hRamp.data();
+        auto gc = _mm256_set1_ps(filter.g), hc = _mm256_set1_ps(filter.h);
+        auto r2g = _mm256_set1_ps(filter.R2 + filter.g);
+
+        for (int s = 0; s < numSamples; ++s) {
+            if (ramped) {
+                gc = _mm256_set1_ps(gs[s]);
+                hc = _mm256_set1_ps(hs[s]);
+                r2g = _mm256_set1_ps(filter.R2 + gs[s]);
+            }
+            __m256 yLow, yHigh;
+            splitTickAvx2(loadGroupsAvx2(in + s * simdLanes, floatStride), yLow, yHigh, gc, hc, r2, r2g, z1, z2, z3, z4);
+            storeGroupsAvx2(outLow + s * simdLanes, floatStride, yLow);
+            storeGroupsAvx2(outHigh + s * simdLanes, floatStride, yHigh);
+        }
+
+        _mm256_storeu_ps(states, z1); _mm256_storeu_ps(states2, z2);
+        _mm256_storeu_ps(states3, z3); _mm256_storeu_ps(states4, z4);
+    }
+
+    TRIO_TARGET_AVX2 static void allpassGroups(LRFilter<SIMDFloat>& filter, int firstGroup, int stride, SIMDFloat* data, int numSamples) {
+        auto* states = toFloatPointer(filter.a1.data() + firstGroup);
+        auto* states2 = toFloatPointer(filter.a2.data() + firstGroup);
+        auto z1 = _mm256_loadu_ps(states), z2 = _mm256_loadu_ps(states2);
+
+        auto* p = toFloatPointer(data);
+        auto floatStride = stride * simdLanes;
+
+        const auto r2 = _mm256_set1_ps(filter.R2);
+        auto ramped = filter.rampActive;
+        auto* gs = filter.gRamp.data();
+        auto* hs = filter.hRamp.data();
+        auto gc = _mm256_set1_ps(filter.g), hc = _mm256_set1_ps(filter.h);
+        auto r2g = _mm256_set1_ps(filter.R2 + filter.g);
+
+        for (int s = 0; s < numSamples; ++s) {
+            if (ramped) {
+                gc = _mm256_set1_ps(gs[s]);
+                hc = _mm256_set1_ps(hs[s]);
+                r2g = _mm256_set1_ps(filter.R2 + gs[s]);
+            }
+            auto* frame = p + s * simdLanes;
+            storeGroupsAvx2(frame, floatStride, allpassTickAvx2(loadGroupsAvx2(frame, floatStride), gc, hc, r2, r2g, z1, z2));
+        }
+
+        _mm256_storeu_ps(states, z1); _mm256_storeu_ps(states2, z2);
+    }
+
+    TRIO_TARGET_AVX2 static void split(LRFilter<SIMDFloat>& filter, int firstGroup, int groups, int stride,
+                                       const SIMDFloat* input, SIMDFloat* low, SIMDFloat* high, int numSamples) {
+        int group = 0;
+        for (; group + avx2Frames <= groups; group += avx2Frames) {
+            auto offset = group * stride;
+            splitGroups(filter, firstGroup + group, stride, input + offset, low + offset, high + offset, numSamples);
+        }
+        auto offset = group * stride;
+        BaselineKernels::split(filter, firstGroup + group, groups - group, stride, input + offset, low + offset, high + offset, numSamples);
+    }
+
+    TRIO_TARGET_AVX2 static void allpass(LRFilter<SIMDFloat>& filter, int firstGroup, int groups, int stride, SIMDFloat* data, int numSamples) {
+        int group = 0;
+        for (; group + avx2Frames <= groups; group += avx2Frames) {
+            allpassGroups(filter, firstGroup + group, stride, data + group * stride, numSamples);
+        }
+        BaselineKernels::allpass(filter, firstGroup + group, groups - group, stride, data + group * stride, numSamples);
+    }
+};
+
+struct Avx512Kernels
+{
+    TRIO_TARGET_AVX512 static void linearToDb(const float* in, float* out, int numValues) {
+        linearToDbBlockAvx512(in, out, numValues);
+    }
+
+    TRIO_TARGET_AVX512 static void dbToLinear(const float* in, float* out, int numValues) {
+        dbToLinearBlockAvx512(in, out, numValues);
+    }
+
+    TRIO_TARGET_AVX512 static void hardKnee(const SIMDFloat* level, const float* threshold, const float* slope, SIMDFloat* gain, int numFrames) {
+        auto* in = toFloatPointer(level);
+        auto* out = toFloatPointer(gain);
+        const auto zero = _mm512_setzero_ps();
+
+        int s = 0;
+        for (; s + avx512Frames <= numFrames; s += avx512Frames) {
+            auto excess = _mm512_sub_ps(_mm512_loadu_ps(in + s * simdLanes), loadRampAvx512(threshold + s));
+            _mm512_storeu_ps(out + s * simdLanes, _mm512_mul_ps(_mm512_max_ps(excess, zero), loadRampAvx512(slope + s)));
+        }
+        Avx2Kernels::hardKnee(level + s, threshold + s, slope + s, gain + s, numFrames - s);
+    }
+
+    TRIO_TARGET_AVX512 static void softKnee(const SIMDFloat* level, const float* threshold, const float* slope,
+                                            const float* knee, const float* curvature, SIMDFloat* gain, int numFrames) {
+        auto* in = toFloatPointer(level);
+        auto* out = toFloatPointer(gain);
+        const auto zero = _mm512_setzero_ps();
+        const auto half = _mm512_set1_ps(0.5f);
+
+        int s = 0;
+        for (; s + avx512Frames <= numFrames; s += avx512Frames) {
+            auto width = loadRampAvx512(knee + s);
+            auto halfWidth = _mm512_mul_ps(half, width);
+            auto excess = _mm512_sub_ps(_mm512_loadu_ps(in + s * simdLanes), loadRampAvx512(threshold + s));
+            auto inKnee = _mm512_min_ps(_mm512_max_ps(_mm512_add_ps(excess, halfWidth), zero), width);
+            auto above = _mm512_max_ps(_mm512_sub_ps(excess, halfWidth), zero);
+            auto db = _mm512_fmadd_ps(_mm512_mul_ps(inKnee, inKnee), loadRampAvx512(curvature + s), above);
+            _mm512_storeu_ps(out + s * simdLanes, _mm512_mul_ps(db, loadRampAvx512(slope + s)));
+        }
+        Avx2Kernels::softKnee(level + s, threshold + s, slope + s, knee + s, curvature + s, gain + s, numFrames - s);
+    }
+
+    TRIO_TARGET_AVX512 static void scale(SIMDFloat* data, const float* ramp, int numFrames) {
+        auto* p = toFloatPointer(data);
+
+        int s = 0;
+        for (; s + avx512Frames <= numFrames; s += avx512Frames) {
+            auto* frame = p + s * simdLanes;
+            _mm512_storeu_ps(frame, _mm512_mul_ps(_mm512_loadu_ps(frame), loadRampAvx512(ramp + s)));
+        }
+        Avx2Kernels::scale(data + s, ramp + s, numFrames - s);
+    }
+
+    TRIO_TARGET_AVX512 static void multiply(SIMDFloat* data, const SIMDFloat* gains, const float* ramp, int numFrames) {
+        auto* p = toFloatPointer(data);
+        auto* g = toFloatPointer(gains);
+
+        int s = 0;
+        if (ramp == nullptr) {
+            for (; s + avx512Frames <= numFrames; s += avx512Frames) {
+                auto i = s * simdLanes;
+                _mm512_storeu_ps(p + i, _mm512_mul_ps(_mm512_loadu_ps(p + i), _mm512_loadu_ps(g + i)));
+            }
+        }
+        else {
+            for (; s + avx512Frames <= numFrames; s += avx512Frames) {
+                auto i = s * simdLanes;
+                auto gained = _mm512_mul_ps(_mm512_loadu_ps(p + i), _mm512_loadu_ps(g + i));
+                _mm512_storeu_ps(p + i, _mm512_mul_ps(gained, loadRampAvx512(ramp + s)));
+            }
+        }
+        Avx2Kernels::multiply(data + s, gains + s, ramp != nullptr ? ramp + s : nullptr, numFrames - s);
+    }
+
+    TRIO_TARGET_AVX512 static void accumulate(SIMDFloat* sum, const SIMDFloat* data, const float* ramp, int numFrames) {
+        auto* out = toFloatPointer(sum);
+        auto* in = toFloatPointer(data);
+
+        int s = 0;
+        for (; s + avx512Frames <= numFrames; s += avx512Frames) {
+            auto i = s * simdLanes;
+            _mm512_storeu_ps(out + i, _mm512_fmadd_ps(_mm512_loadu_ps(in + i), loadRampAvx512(ramp + s), _mm512_loadu_ps(out + i)));
+        }
+        Avx2Kernels::accumulate(sum + s, data + s, ramp + s, numFrames - s);
+    }
+
+    TRIO_TARGET_AVX512 static void mix(SIMDFloat* dry, const SIMDFloat* wet, const float* wetRamp, const float* gainRamp, int numFrames) {
+        auto* out = toFloatPointer(dry);
+        auto* in = toFloatPointer(wet);
+        const auto one = _mm512_set1_ps(1.0f);
+
+        int s = 0;
+        for (; s + avx512Frames <= numFrames; s += avx512Frames) {
+            auto i = s * simdLanes;
+            auto share = loadRampAvx512(wetRamp + s);
+            auto wetGain = _mm512_mul_ps(loadRampAvx512(gainRamp + s), share);
+            auto dryPart = _mm512_mul_ps(_mm512_loadu_ps(out + i), _mm512_sub_ps(one, share));
+            _mm512_storeu_ps(out + i, _mm512_fmadd_ps(_mm512_loadu_ps(in + i), wetGain, dryPart));
+        }
+        Avx2Kernels::mix(dry + s, wet + s, wetRamp + s, gainRamp + s, numFrames - s);
+    }
+
+    // avx512Frames lane groups from firstGroup on.
+    TRIO_TARGET_AVX512 static void splitGroups(LRFilter<SIMDFloat>& filter, int firstGroup, int stride,
+                                               const SIMDFloat* input, SIMDFloat* low, SIMDFloat* high, int numSamples) {
+        auto* states = toFloatPointer(filter.s1.data() + firstGroup);
+        auto* states2 = toFloatPointer(filter.s2.data() + firstGroup);
+        auto* states3 = toFloatPointer(filter.s3.data() + firstGroup);
+        auto* states4 = toFloatPointer(filter.s4.data() + firstGroup);
+        auto z1 = _mm512_loadu_ps(states), z2 = _mm512_loadu_ps(states2);
+        auto z3 = _mm512_loadu_ps(states3), z4 = _mm512_loadu_ps(states4);
+
+        auto* in = toFloatPointer(input);
+        auto* outLow = toFloatPointer(low);
+        auto* outHigh = toFloatPointer(high);
+        auto floatStride = stride * simdLanes;
+
+        const auto r2 = _mm512_set1_ps(filter.R2);
+        auto ramped = filter.rampActive;
+        auto* gs = filter.gRamp.data();
+        auto* hs = filter.hRamp.data();
+        auto gc = _mm512_set1_ps(filter.g), hc = _mm512_set1_ps(filter.h);
+        auto r2g = _mm512_set1_ps(filter.R2 + filter.g);
+
+        for (int s = 0; s < numSamples; ++s) {
+            if (ramped) {
+                gc = _mm512_set1_ps(gs[s]);
+                hc = _mm512_set1_ps(hs[s]);
+                r2g = _mm512_set1_ps(filter.R2 + gs[s]);
+            }
+            __m512 yLow, yHigh;
+            splitTickAvx512(loadGroupsAvx512(in + s * simdLanes, floatStride), yLow, yHigh, gc, hc, r2, r2g, z1, z2, z3, z4);
+            storeGroupsAvx512(outLow + s * simdLanes, floatStride, yLow);
+            storeGroupsAvx512(outHigh + s * simdLanes, floatStride, yHigh);
+        }
+
+        _mm512_storeu_ps(states, z1); _mm512_storeu_ps(states2, z2);
+        _mm512_storeu_ps(states3, z3); _mm512_storeu_ps(states4, z4);
+    }
+
+    TRIO_TARGET_AVX512 static void allpassGroups(LRFilter<SIMDFloat>& filter, int firstGroup, int stride, SIMDFloat* data, int numSamples) {
+        auto* states = toFloatPointer(filter.a1.data() + firstGroup);
+        auto* states2 = toFloatPointer(filter.a2.data() + firstGroup);
+        auto z1 = _mm512_loadu_ps(states), z2 = _mm512_loadu_ps(states2);
+
+        auto* p = toFloatPointer(data);
+        auto floatStride = stride * simdLanes;
+
+        const auto r2 = _mm512_set1_ps(filter.R2);
+        auto ramped = filter.rampActive;
+        auto* gs = filter.gRamp.data();
+        auto* hs = filter.hRamp.data();
+        auto gc = _mm512_set1_ps(filter.g), hc = _mm512_set1_ps(filter.h);
+        auto r2g = _mm512_set1_ps(filter.R2 + filter.g);
+
+        for (int s = 0; s < numSamples; ++s) {
+            if (ramped) {
+                gc = _mm512_set1_ps(gs[s]);
+                hc = _mm512_set1_ps(hs[s]);
+                r2g = _mm512_set1_ps(filter.R2 + gs[s]);
+            }
+            auto* frame = p + s * simdLanes;
+            storeGroupsAvx512(frame, floatStride, allpassTickAvx512(loadGroupsAvx512(frame, floatStride), gc, hc, r2, r2g, z1, z2));
+        }
+
+        _mm512_storeu_ps(states, z1); _mm512_storeu_ps(states2, z2);
+    }
+
+    TRIO_TARGET_AVX512 static void split(LRFilter<SIMDFloat>& filter, int firstGroup, int groups, int stride,
+                                         const SIMDFloat* input, SIMDFloat* low, SIMDFloat* high, int numSamples) {
+        int group = 0;
+        for (; group + avx512Frames <= groups; group += avx512Frames) {
+            auto offset = group * stride;
+            splitGroups(filter, firstGroup + group, stride, input + offset, low + offset, high + offset, numSamples);
+        }
+        auto offset = group * stride;
+        Avx2Kernels::split(filter, firstGroup + group, groups - group, stride, input + offset, low + offset, high + offset, numSamples);
+    }
+
+    TRIO_TARGET_AVX512 static void allpass(LRFilter<SIMDFloat>& filter, int firstGroup, int groups, int stride, SIMDFloat* data, int numSamples) {
+        int group = 0;
+        for (; group + avx512Frames <= groups; group += avx512Frames) {
+            allpassGroups(filter, firstGroup + group, stride, data + group * stride, numSamples);
+        }
+        Avx2Kernels::allpass(filter, firstGroup + group, groups - group, stride, data + group * stride, numSamples);
+    }
+};
+
+#endif
+
+template <typename Kernels>
+inline EngineKernels makeEngineKernels(InstructionSet set) {
+    return { set, &Kernels::linearToDb, &Kernels::dbToLinear, &Kernels::hardKnee, &Kernels::softKnee,
+             &Kernels::scale, &Kernels::multiply, &Kernels::accumulate, &Kernels::mix,
+             &Kernels::split, &Kernels::allpass };
+}
+
+inline const char* getInstructionSetName(InstructionSet set) {
+    switch (set) {
+        case InstructionSet::automatic: return "auto";
+        case InstructionSet::avx2:      return "avx2";
+        case InstructionSet::avx512:    return "avx512";
+        case InstructionSet::baseline:  break;
+    }
+#if JUCE_USE_SSE_INTRINSICS
+    return "sse2";
+#elif JUCE_USE_ARM_NEON
+    return "neon";
+#else
+    return "generic";
+#endif
+}
+
+// automatic for names of no set.
+inline InstructionSet instructionSetFromName(const juce::String& name) {
+    for (auto set : { InstructionSet::baseline, InstructionSet::avx2, InstructionSet::avx512 }) {
+        if (name.trim().equalsIgnoreCase(getInstructionSetName(set))) return set;
+    }
+    return InstructionSet::automatic;
+}
+
+inline bool isSupported(InstructionSet set) {
+    switch (set) {
+        case InstructionSet::automatic:
+        case InstructionSet::baseline:  return true;
+#if TRIO_WIDE_KERNELS
+        case InstructionSet::avx2:      return juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3();
+        case InstructionSet::avx512:    return juce::SystemStats::hasAVX512F() && juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3();
+#else
+        default:                        return false;
+#endif
+    }
+    return false;
+}
+
+// The kernels for set, or for the widest set below it the CPU has. automatic
+// takes the set named by TRIO_ISA, read once, or else the widest set.
+inline const EngineKernels& selectKernels(InstructionSet set) {
+    static const EngineKernels kernels[] = {
+        makeEngineKernels<BaselineKernels>(InstructionSet::baseline),
+#if TRIO_WIDE_KERNELS
+        makeEngineKernels<Avx2Kernels>(InstructionSet::avx2),
+        makeEngineKernels<Avx512Kernels>(InstructionSet::avx512),
+#endif
+    };
+
+    static const auto fromEnvironment = instructionSetFromName(juce::SystemStats::getEnvironmentVariable("TRIO_ISA", {}));
+
+    if (set == InstructionSet::automatic) set = fromEnvironment;
+
+    for (int i = static_cast<int>(std::size(kernels)) - 1; i > 0; --i) {
+        auto candidate = kernels[i].instructionSet;
+        if ((set == InstructionSet::automatic || static_cast<int>(candidate) <= static_cast<int>(set)) && isSupported(candidate)) {
+            return kernels[i];
+        }
+    }
+    return kernels[0];
+}
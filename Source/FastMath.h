@@ -0,0 +1,346 @@
+/*
+  ==============================================================================
+
+    FastMath.h
+
+    Block kernels for the dB <-> linear conversions on the detector path.
+
+    log2 uses the float exponent plus a degree 5 polynomial on the mantissa
+    (max error 1.5e-5 in log2, i.e. < 0.0001 dB). exp2 splits integer and
+    fractional parts and uses a degree 4 polynomial (max relative error 4.2e-6,
+    i.e. < 0.0001 dB). Both are exact at 0 dB / unity gain.
+
+    Build with TRIO_EXACT_MATH=1 to route every conversion through libm, e.g.
+    for reference renders.
+
+    On x86 the block kernels also come in AVX2 (with FMA) and AVX-512
+    versions, compiled with per-function targets next to the SSE2 ones and
+    picked at run time (see Dispatch.h). Build with TRIO_DISPATCH=0 to leave
+    them out.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <cstdint>
+#include <cstring>
+#include "Utils.h"
+
+#ifndef TRIO_EXACT_MATH
+ #define TRIO_EXACT_MATH 0
+#endif
+
+#ifndef TRIO_DISPATCH
+ #define TRIO_DISPATCH 1
+#endif
+
+#if JUCE_USE_SSE_INTRINSICS
+ #include <emmintrin.h>
+#elif JUCE_USE_ARM_NEON
+ #include <arm_neon.h>
+#endif
+
+// Functions marked with these may use the instructions of their set; only
+// call them once the CPU is known to have it. MSVC takes the intrinsics
+// anywhere, so it needs no marks.
+#if TRIO_DISPATCH && JUCE_USE_SSE_INTRINSICS
+ #define TRIO_WIDE_KERNELS 1
+ #include <immintrin.h>
+ #if defined (_MSC_VER) && ! defined (__clang__)
+  #define TRIO_TARGET_AVX2
+  #define TRIO_TARGET_AVX512
+ #else
+  #define TRIO_TARGET_AVX2   __attribute__((target("avx2,fma")))
+  #define TRIO_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+ #endif
+#else
+ #define TRIO_WIDE_KERNELS 0
+#endif
+
+#define DB_PER_OCTAVE  6.0205999132796239f   // 20 * log10(2)
+#define OCTAVES_PER_DB 0.1660964047443681f   // log2(10) / 20
+#define LEVEL_FLOOR    0.000001f             // same floor as linearToDb()
+
+#define LOG2_C1  1.4419655807840823f
+#define LOG2_C2 -0.7096624757968834f
+#define LOG2_C3  0.4175947386160088f
+#define LOG2_C4 -0.1962683888939124f
+#define LOG2_C5  0.0463848462728755f
+
+#define EXP2_C1 0.6930185282424233f
+#define EXP2_C2 0.2414455099583724f
+#define EXP2_C3 0.0519505412027019f
+#define EXP2_C4 0.0135812514496263f
+
+// Valid for normal, positive x.
+inline float fastLog2(float x) {
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+
+    auto exponent = static_cast<float>(static_cast<int32_t>(bits >> 23) - 127);
+    bits = (bits & 0x007fffffu) | 0x3f800000u;
+
+    float mantissa;
+    std::memcpy(&mantissa, &bits, sizeof(mantissa));
+
+    auto t = mantissa - 1.0f;
+    return exponent + t * (LOG2_C1 + t * (LOG2_C2 + t * (LOG2_C3 + t * (LOG2_C4 + t * LOG2_C5))));
+}
+
+inline float fastExp2(float x) {
+    x = std::min(std::max(x, -126.0f), 126.0f);
+
+    auto whole = std::floor(x);
+    auto f = x - whole;
+    auto p = 1.0f + f * (EXP2_C1 + f * (EXP2_C2 + f * (EXP2_C3 + f * EXP2_C4)));
+
+    auto bits = static_cast<uint32_t>(static_cast<int32_t>(whole) + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+
+    return p * scale;
+}
+
+inline float fastLinearToDb(float x) {
+    return DB_PER_OCTAVE * fastLog2(std::abs(x) + LEVEL_FLOOR);
+}
+
+inline float fastDbToLinear(float x) {
+    return fastExp2(x * OCTAVES_PER_DB);
+}
+
+#if JUCE_USE_SSE_INTRINSICS
+
+inline __m128 fastLog2(__m128 x) {
+    auto bits = _mm_castps_si128(x);
+    auto exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+    auto mantissa = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+                                                  _mm_set1_epi32(0x3f800000)));
+    auto t = _mm_sub_ps(mantissa, _mm_set1_ps(1.0f));
+
+    auto p = _mm_add_ps(_mm_set1_ps(LOG2_C4), _mm_mul_ps(t, _mm_set1_ps(LOG2_C5)));
+    p = _mm_add_ps(_mm_set1_ps(LOG2_C3), _mm_mul_ps(t, p));
+    p = _mm_add_ps(_mm_set1_ps(LOG2_C2), _mm_mul_ps(t, p));
+    p = _mm_add_ps(_mm_set1_ps(LOG2_C1), _mm_mul_ps(t, p));
+    return _mm_add_ps(exponent, _mm_mul_ps(t, p));
+}
+
+inline __m128 fastExp2(__m128 x) {
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-126.0f)), _mm_set1_ps(126.0f));
+
+    // SSE2 has no floor: truncate, then step down where truncation rounded up.
+    auto whole = _mm_cvttps_epi32(x);
+    auto roundedUp = _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(whole), x));
+    whole = _mm_add_epi32(whole, roundedUp);
+    auto f = _mm_sub_ps(x, _mm_cvtepi32_ps(whole));
+
+    auto p = _mm_add_ps(_mm_set1_ps(EXP2_C3), _mm_mul_ps(f, _mm_set1_ps(EXP2_C4)));
+    p = _mm_add_ps(_mm_set1_ps(EXP2_C2), _mm_mul_ps(f, p));
+    p = _mm_add_ps(_mm_set1_ps(EXP2_C1), _mm_mul_ps(f, p));
+    p = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(f, p));
+
+    auto scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(whole, _mm_set1_epi32(127)), 23));
+    return _mm_mul_ps(p, scale);
+}
+
+#elif JUCE_USE_ARM_NEON
+
+inline float32x4_t fastLog2(float32x4_t x) {
+    auto bits = vreinterpretq_u32_f32(x);
+    auto exponent = vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), vdupq_n_s32(127)));
+    auto mantissa = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x007fffff)),
+                                                    vdupq_n_u32(0x3f800000)));
+    auto t = vsubq_f32(mantissa, vdupq_n_f32(1.0f));
+
+    auto p = vmlaq_f32(vdupq_n_f32(LOG2_C4), t, vdupq_n_f32(LOG2_C5));
+    p = vmlaq_f32(vdupq_n_f32(LOG2_C3), t, p);
+    p = vmlaq_f32(vdupq_n_f32(LOG2_C2), t, p);
+    p = vmlaq_f32(vdupq_n_f32(LOG2_C1), t, p);
+    return vmlaq_f32(exponent, t, p);
+}
+
+inline float32x4_t fastExp2(float32x4_t x) {
+    x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(-126.0f)), vdupq_n_f32(126.0f));
+
+    auto whole = vcvtq_s32_f32(x);
+    auto roundedUp = vreinterpretq_s32_u32(vcgtq_f32(vcvtq_f32_s32(whole), x));
+    whole = vaddq_s32(whole, roundedUp);
+    auto f = vsubq_f32(x, vcvtq_f32_s32(whole));
+
+    auto p = vmlaq_f32(vdupq_n_f32(EXP2_C3), f, vdupq_n_f32(EXP2_C4));
+    p = vmlaq_f32(vdupq_n_f32(EXP2_C2), f, p);
+    p = vmlaq_f32(vdupq_n_f32(EXP2_C1), f, p);
+    p = vmlaq_f32(vdupq_n_f32(1.0f), f, p);
+
+    auto scale = vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(whole, vdupq_n_s32(127)), 23));
+    return vmulq_f32(p, scale);
+}
+
+#endif
+
+// out[i] = 20 * log10(|in[i]| + 1e-6). in and out may alias.
+inline void linearToDbBlock(const float* in, float* out, int numSamples) {
+    int i = 0;
+
+#if ! TRIO_EXACT_MATH
+ #if JUCE_USE_SSE_INTRINSICS
+    const auto absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    for (; i + 4 <= numSamples; i += 4) {
+        auto x = _mm_add_ps(_mm_and_ps(_mm_loadu_ps(in + i), absMask), _mm_set1_ps(LEVEL_FLOOR));
+        _mm_storeu_ps(out + i, _mm_mul_ps(fastLog2(x), _mm_set1_ps(DB_PER_OCTAVE)));
+    }
+ #elif JUCE_USE_ARM_NEON
+    for (; i + 4 <= numSamples; i += 4) {
+        auto x = vaddq_f32(vabsq_f32(vld1q_f32(in + i)), vdupq_n_f32(LEVEL_FLOOR));
+        vst1q_f32(out + i, vmulq_n_f32(fastLog2(x), DB_PER_OCTAVE));
+    }
+ #endif
+    for (; i < numSamples; ++i) out[i] = fastLinearToDb(in[i]);
+#else
+    for (; i < numSamples; ++i) out[i] = linearToDb(in[i]);
+#endif
+}
+
+// out[i] = 10^(in[i] / 20). in and out may alias.
+inline void dbToLinearBlock(const float* in, float* out, int numSamples) {
+    int i = 0;
+
+#if ! TRIO_EXACT_MATH
+ #if JUCE_USE_SSE_INTRINSICS
+    for (; i + 4 <= numSamples; i += 4) {
+        _mm_storeu_ps(out + i, fastExp2(_mm_mul_ps(_mm_loadu_ps(in + i), _mm_set1_ps(OCTAVES_PER_DB))));
+    }
+ #elif JUCE_USE_ARM_NEON
+    for (; i + 4 <= numSamples; i += 4) {
+        vst1q_f32(out + i, fastExp2(vmulq_n_f32(vld1q_f32(in + i), OCTAVES_PER_DB)));
+    }
+ #endif
+    for (; i < numSamples; ++i) out[i] = fastDbToLinear(in[i]);
+#else
+    for (; i < numSamples; ++i) out[i] = dbToLinear(in[i]);
+#endif
+}
+
+#if TRIO_WIDE_KERNELS
+
+TRIO_TARGET_AVX2 inline __m256 fastLog2(__m256 x) {
+    auto bits = _mm256_castps_si256(x);
+    auto exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+    auto mantissa = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)),
+                                                        _mm256_set1_epi32(0x3f800000)));
+    auto t = _mm256_sub_ps(mantissa, _mm256_set1_ps(1.0f));
+
+    auto p = _mm256_fmadd_ps(t, _mm256_set1_ps(LOG2_C5), _mm256_set1_ps(LOG2_C4));
+    p = _mm256_fmadd_ps(t, p, _mm256_set1_ps(LOG2_C3));
+    p = _mm256_fmadd_ps(t, p, _mm256_set1_ps(LOG2_C2));
+    p = _mm256_fmadd_ps(t, p, _mm256_set1_ps(LOG2_C1));
+    return _mm256_fmadd_ps(t, p, exponent);
+}
+
+TRIO_TARGET_AVX2 inline __m256 fastExp2(__m256 x) {
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-126.0f)), _mm256_set1_ps(126.0f));
+
+    auto whole = _mm256_floor_ps(x);
+    auto f = _mm256_sub_ps(x, whole);
+
+    auto p = _mm256_fmadd_ps(f, _mm256_set1_ps(EXP2_C4), _mm256_set1_ps(EXP2_C3));
+    p = _mm256_fmadd_ps(f, p, _mm256_set1_ps(EXP2_C2));
+    p = _mm256_fmadd_ps(f, p, _mm256_set1_ps(EXP2_C1));
+    p = _mm256_fmadd_ps(f, p, _mm256_set1_ps(1.0f));
+
+    auto scale = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(whole), _mm256_set1_epi32(127)), 23));
+    return _mm256_mul_ps(p, scale);
+}
+
+TRIO_TARGET_AVX512 inline __m512 fastLog2(__m512 x) {
+    auto bits = _mm512_castps_si512(x);
+    auto exponent = _mm512_cvtepi32_ps(_mm512_sub_epi32(_mm512_srli_epi32(bits, 23), _mm512_set1_epi32(127)));
+    auto mantissa = _mm512_castsi512_ps(_mm512_or_si512(_mm512_and_si512(bits, _mm512_set1_epi32(0x007fffff)),
+                                                        _mm512_set1_epi32(0x3f800000)));
+    auto t = _mm512_sub_ps(mantissa, _mm512_set1_ps(1.0f));
+
+    auto p = _mm512_fmadd_ps(t, _mm512_set1_ps(LOG2_C5), _mm512_set1_ps(LOG2_C4));
+    p = _mm512_fmadd_ps(t, p, _mm512_set1_ps(LOG2_C3));
+    p = _mm512_fmadd_ps(t, p, _mm512_set1_ps(LOG2_C2));
+    p = _mm512_fmadd_ps(t, p, _mm512_set1_ps(LOG2_C1));
+    return _mm512_fmadd_ps(t, p, exponent);
+}
+
+TRIO_TARGET_AVX512 inline __m512 fastExp2(__m512 x) {
+    x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(-126.0f)), _mm512_set1_ps(126.0f));
+
+    auto whole = _mm512_roundscale_ps(x, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+    auto f = _mm512_sub_ps(x, whole);
+
+    auto p = _mm512_fmadd_ps(f, _mm512_set1_ps(EXP2_C4), _mm512_set1_ps(EXP2_C3));
+    p = _mm512_fmadd_ps(f, p, _mm512_set1_ps(EXP2_C2));
+    p = _mm512_fmadd_ps(f, p, _mm512_set1_ps(EXP2_C1));
+    p = _mm512_fmadd_ps(f, p, _mm512_set1_ps(1.0f));
+
+    auto scale = _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_add_epi32(_mm512_cvtps_epi32(whole), _mm512_set1_epi32(127)), 23));
+    return _mm512_mul_ps(p, scale);
+}
+
+// As linearToDbBlock(), eight or sixteen values at a time; the rest go
+// through the SSE2 kernel.
+TRIO_TARGET_AVX2 inline void linearToDbBlockAvx2(const float* in, float* out, int numSamples) {
+    int i = 0;
+ #if ! TRIO_EXACT_MATH
+    const auto absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    for (; i + 8 <= numSamples; i += 8) {
+        auto x = _mm256_add_ps(_mm256_and_ps(_mm256_loadu_ps(in + i), absMask), _mm256_set1_ps(LEVEL_FLOOR));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(fastLog2(x), _mm256_set1_ps(DB_PER_OCTAVE)));
+    }
+ #endif
+    linearToDbBlock(in + i, out + i, numSamples - i);
+}
+
+TRIO_TARGET_AVX512 inline void linearToDbBlockAvx512(const float* in, float* out, int numSamples) {
+    int i = 0;
+ #if ! TRIO_EXACT_MATH
+    const auto absMask = _mm512_set1_epi32(0x7fffffff);
+    for (; i + 16 <= numSamples; i += 16) {
+        auto magnitude = _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(_mm512_loadu_ps(in + i)), absMask));
+        auto x = _mm512_add_ps(magnitude, _mm512_set1_ps(LEVEL_FLOOR));
+        _mm512_storeu_ps(out + i, _mm512_mul_ps(fastLog2(x), _mm512_set1_ps(DB_PER_OCTAVE)));
+    }
+ #endif
+    linearToDbBlockAvx2(in + i, out + i, numSamples - i);
+}
+
+TRIO_TARGET_AVX2 inline void dbToLinearBlockAvx2(const float* in, float* out, int numSamples) {
+    int i = 0;
+ #if ! TRIO_EXACT_MATH
+    for (; i + 8 <= numSamples; i += 8) {
+        _mm256_storeu_ps(out + i, fastExp2(_mm256_mul_ps(_mm256_loadu_ps(in + i), _mm256_set1_ps(OCTAVES_PER_DB))));
+    }
+ #endif
+    dbToLinearBlock(in + i, out + i, numSamples - i);
+}
+
+TRIO_TARGET_AVX512 inline void dbToLinearBlockAvx512(const float* in, float* out, int numSamples) {
+    int i = 0;
+ #if ! TRIO_EXACT_MATH
+    for (; i + 16 <= numSamples; i += 16) {
+        _mm512_storeu_ps(out + i, fastExp2(_mm512_mul_ps(_mm512_loadu_ps(in + i), _mm512_set1_ps(OCTAVES_PER_DB))));
+    }
+ #endif
+    dbToLinearBlockAvx2(in + i, out + i, numSamples - i);
+}
+
+#endif
+
+#undef DB_PER_OCTAVE
+#undef OCTAVES_PER_DB
+#undef LEVEL_FLOOR
+#undef LOG2_C1
+#undef LOG2_C2
+#undef LOG2_C3
+#undef LOG2_C4
+#undef LOG2_C5
+#undef EXP2_C1
+#undef EXP2_C2
+#undef EXP2_C3
+#undef EXP2_C4
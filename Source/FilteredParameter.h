@@ -1,82 +1,219 @@
 
 #pragma once
 
+#include "Utils.h"
 #include "Filters.h"
 
 #define DEFAULT_FILTER_FREQ 0.5f
 #define DEFAULT_SR          44100.0f
 
+// Distance from value, relative to max(|value|, 1), at which a smoother lands.
+#define SETTLE_TOLERANCE    1.0e-6f
+
+// One-pole smoothing towards value, generated a block at a time. Sample s of
+// a block is value + distance * decay^(s + 1), which needs no feedback, so
+// whole lane groups of the ramp are written at once. The distance is kept
+// apart from value, so it keeps shrinking once it is below the float spacing
+// at value; when it falls below SETTLE_TOLERANCE the ramp lands on value
+// exactly and stays there until the value changes.
 class FilteredParameter
 {
-    OnePoleFilter filter{ DEFAULT_FILTER_FREQ };
     float sampleRate{ DEFAULT_SR };
     float value{ 0.0f };
-    float frequency{ DEFAULT_FILTER_FREQ };
+    float distance{ 0.0f };
+
+    float rate{ 0.0f };             // decay = exp(-rate)
+    SIMDFloat laneDecays{ 1.0f };   // decay^1 .. decay^simdLanes
+    float groupDecay{ 1.0f };       // decay^simdLanes
+
+    vector<SIMDFloat> ramp;
+    bool rampHoldsValue{ false };
 
 public:
 
-    FilteredParameter(float sr = DEFAULT_SR) : sampleRate(sr) {}
+    FilteredParameter(float sr = DEFAULT_SR) { setSampleRate(sr); }
 
     void prepare(float sr, float v) {
-        filter.setSampleRate(sr);
-        filter.setFrequency(DEFAULT_FILTER_FREQ);
-        value = v;
+        setSampleRate(sr);
+        setValue(v);
+        rampHoldsValue = false;
+    }
+
+    // Changes the smoothing rate, keeping the current value and state.
+    void setSampleRate(float sr) {
+        sampleRate = sr;
+        rate = juce::MathConstants<float>::twoPi * DEFAULT_FILTER_FREQ / sampleRate;
+        for (int l = 0; l < simdLanes; ++l) {
+            laneDecays.set(static_cast<size_t>(l), std::exp(-rate * static_cast<float>(l + 1)));
+        }
+        groupDecay = std::exp(-rate * static_cast<float>(simdLanes));
+    }
+
+    void setMaxBlockSize(int numSamples) {
+        ramp.assign(static_cast<size_t>((numSamples + simdLanes - 1) / simdLanes), SIMDFloat(value));
+        rampHoldsValue = false;
+    }
+
+    int capacity() const {
+        return static_cast<int>(ramp.size()) * simdLanes;
+    }
+
+    // Writes the next numSamples values to the ramp and returns how many
+    // leading values changed: numSamples while moving, the whole ramp once on
+    // settling, then 0 until the value changes again.
+    int advance(int numSamples) {
+        jassert(numSamples <= capacity());
+
+        if (distance == 0.0f) {
+            if (rampHoldsValue) return 0;
+            std::fill(ramp.begin(), ramp.end(), SIMDFloat(value));
+            rampHoldsValue = true;
+            return capacity();
+        }
+
+        rampHoldsValue = false;
+        const SIMDFloat target(value), step(groupDecay);
+        auto decays = laneDecays;
+        auto groups = (numSamples + simdLanes - 1) / simdLanes;
+
+        for (int i = 0; i < groups; ++i) {
+            ramp[i] = target + decays * distance;
+            decays = decays * step;
+        }
+
+        distance *= std::exp(-rate * static_cast<float>(numSamples));
+        if (std::abs(distance) <= std::max(std::abs(value), 1.0f) * SETTLE_TOLERANCE) distance = 0.0f;
+        return numSamples;
     }
 
-    // Filter then return current value
-    float next() {
-        return filter.process(value);
+    // The values written by the last advance().
+    const float* getRamp() const {
+        return toFloatPointer(ramp.data());
     }
 
     // Just return current value
-    float read() {
+    float read() const {
         return value;
     }
 
+    bool isSettled() const {
+        return distance == 0.0f;
+    }
+
+    // True when the ramp holds exactly v.
+    bool isAt(float v) const {
+        return value == v && isSettled();
+    }
 
+    // Seconds for the output to cover 1 - 1/e of a step in value.
+    static float timeConstant() {
+        return 1.0f / (juce::MathConstants<float>::twoPi * DEFAULT_FILTER_FREQ);
+    }
+
+
+    // Glides on from where the ramp is now.
     void setValue(float v) {
+        distance += value - v;
         value = v;
     }
 };
 
 #define SILENCE 0.000001f
 
+// Multiplicative fade between gains over attackTime or releaseTime ms, a
+// block at a time like FilteredParameter: sample s is current * multiplier^(s + 1),
+// clamped at the target, and it lands on the target once within 0.0001.
 class SmoothLogParameter
 {
     float currentGain, targetGain, multiplier;
     float attackTime, releaseTime, fadeSize{ 1.0f };
     float sampleRate{ DEFAULT_SR };
 
+    SIMDFloat laneMultipliers{ 1.0f };  // multiplier^1 .. multiplier^simdLanes
+    float groupMultiplier{ 1.0f };      // multiplier^simdLanes
+
+    vector<SIMDFloat> ramp;
+    bool rampHoldsTarget{ false };
+
 public:
     SmoothLogParameter(float atk = 150.0f, float rls = 150.0f) : attackTime(atk), releaseTime(rls), currentGain(SILENCE), targetGain(SILENCE), multiplier(1.0) {}
 
+    // Starts at the target: a gain of exactly 0 could never fade back in.
     void prepare(float sr, float v) {
         sampleRate = sr;
-        currentGain = v;
+        currentGain = v + SILENCE;
         setValue(v);
     }
 
+    void setMaxBlockSize(int numSamples) {
+        ramp.assign(static_cast<size_t>((numSamples + simdLanes - 1) / simdLanes), SIMDFloat(currentGain));
+        rampHoldsTarget = false;
+    }
+
+    int capacity() const {
+        return static_cast<int>(ramp.size()) * simdLanes;
+    }
+
     void setValue(float v) {
         targetGain = v + SILENCE;
         if (targetGain < currentGain) fadeSize = lengthToSamples(releaseTime, sampleRate);
         else if (targetGain > currentGain ) fadeSize = lengthToSamples(attackTime, sampleRate);
         multiplier = std::pow(targetGain / currentGain, 1.0f / fadeSize);
+
+        auto power = 1.0f;
+        for (int l = 0; l < simdLanes; ++l) {
+            power *= multiplier;
+            laneMultipliers.set(static_cast<size_t>(l), power);
+        }
+        groupMultiplier = power;
+        rampHoldsTarget = false;
     }
 
-    float next() {
-        if (std::abs(currentGain - targetGain) > 0.0001f) {
-            currentGain *= multiplier;
-            if ((multiplier > 1.0f && currentGain >= targetGain) || (multiplier < 1.0f && currentGain <= targetGain)) {
-                currentGain = targetGain;
-            }
+    // As FilteredParameter::advance().
+    int advance(int numSamples) {
+        jassert(numSamples <= capacity());
+
+        if (currentGain == targetGain) {
+            if (rampHoldsTarget) return 0;
+            std::fill(ramp.begin(), ramp.end(), SIMDFloat(targetGain));
+            rampHoldsTarget = true;
+            return capacity();
         }
-        return currentGain;
+
+        const SIMDFloat start(currentGain), target(targetGain), step(groupMultiplier);
+        auto gains = laneMultipliers;
+        auto rising = targetGain > currentGain;
+        auto groups = (numSamples + simdLanes - 1) / simdLanes;
+
+        for (int i = 0; i < groups; ++i) {
+            ramp[i] = rising ? SIMDFloat::min(start * gains, target) : SIMDFloat::max(start * gains, target);
+            gains = gains * step;
+        }
+
+        currentGain = getRamp()[numSamples - 1];
+        if (std::abs(currentGain - targetGain) <= 0.0001f) currentGain = targetGain;
+        return numSamples;
+    }
+
+    // The gains written by the last advance().
+    const float* getRamp() const {
+        return toFloatPointer(ramp.data());
     }
 
     float read() {
         return currentGain;
     }
+
+    bool isSettled() const {
+        return currentGain == targetGain;
+    }
+
+    // Faded out to nothing.
+    bool isOff() const {
+        return isSettled() && targetGain <= SILENCE;
+    }
 };
 
 
-#undef DEFAULT_SR
\ No newline at end of file
+#undef SETTLE_TOLERANCE
+#undef DEFAULT_SR
@@ -2,43 +2,266 @@
 
 #include <JuceHeader.h>
 
+#include <vector>
+#include <algorithm>
+#include <cmath>
+using std::vector;
+
 #define M_PI 3.14159265358979323846
 #define DEFAULT_SR 44100.0f
+#define DEFAULT_CONTROL_INTERVAL 32
+#define CUTOFF_TOLERANCE 1.0e-4
 
+// Linkwitz-Riley 4th order crossover: two cascaded TPT state variable
+// Butterworth sections, the same topology as juce::dsp::LinkwitzRileyFilter.
+// Coefficients are only recomputed at control points (every controlInterval
+// samples) and only when the cutoff has actually moved; between control points
+// g is interpolated linearly, which keeps the TPT structure stable under modulation.
+// T may be a juce::dsp::SIMDRegister, in which case each lane is one channel and
+// the coefficients stay scalar.
 template <typename T>
 struct LRFilter
 {
-	juce::dsp::LinkwitzRileyFilter<float> filter;
-	int type{ 0 };
-	T frequency{ 0.0f };
+	using NumericType = typename juce::dsp::SampleTypeHelpers::ElementType<T>::Type;
+
+	NumericType frequency{ 0.0f };
 
 	float sampleRate{ DEFAULT_SR };
 	float blockSize{ 0.0f };
 	int   nChannels{ 1 };
+	int   controlInterval{ DEFAULT_CONTROL_INTERVAL };
 
-	LRFilter() {
-		filter.setType(juce::dsp::LinkwitzRileyFilterType::allpass);
-	}
+	NumericType g{ 0.0f }, h{ 1.0f };
+	NumericType R2{ static_cast<NumericType>(1.4142135623730951) };
+
+	vector<T> s1, s2, s3, s4;
 
-	void setFrequency(T f) {
+	// State of the phase compensation allpass, see processAllpass().
+	vector<T> a1, a2;
+
+	// Per-sample coefficients for the current block, only used while the cutoff moves.
+	vector<NumericType> gRamp, hRamp;
+	bool rampActive{ false };
+
+	void setFrequency(NumericType f) {
+		if (!hasMoved(f)) return;
 		frequency = f;
-		filter.setCutoffFrequency(frequency);
+		g = cutoffToG(frequency);
+		h = gToH(g);
+	}
+
+	void setControlInterval(int samples) {
+		controlInterval = std::max(1, samples);
 	}
 
 	void prepare(float sr, float numSamples, int numChannels) {
 		sampleRate = sr;
 		blockSize = numSamples;
 		nChannels = numChannels;
-		juce::dsp::ProcessSpec spec;
-		spec.sampleRate = sampleRate;
-		spec.maximumBlockSize = blockSize;
-		spec.numChannels = nChannels;
 
-		filter.prepare(spec);
+		for (auto* state : { &s1, &s2, &s3, &s4, &a1, &a2 }) {
+			state->assign(nChannels, static_cast<T>(0));
+		}
+
+		gRamp.assign(static_cast<size_t>(blockSize), g);
+		hRamp.assign(static_cast<size_t>(blockSize), h);
+
+		rampActive = false;
+		g = cutoffToG(frequency);
+		h = gToH(g);
+	}
+
+	void reset() {
+		for (auto* state : { &s1, &s2, &s3, &s4, &a1, &a2 }) {
+			std::fill(state->begin(), state->end(), static_cast<T>(0));
+		}
+	}
+
+	// Only channels first .. first + count - 1.
+	void reset(int first, int count) {
+		for (auto* state : { &s1, &s2, &s3, &s4, &a1, &a2 }) {
+			std::fill(state->begin() + first, state->begin() + first + count, static_cast<T>(0));
+		}
+	}
+
+	// Samples the (smoothed) cutoff once per control interval and builds the
+	// coefficient ramps for the next processBlock() calls. In the steady state
+	// this costs one comparison per control point and no transcendental math.
+	void updateCoefficients(const NumericType* cutoff, int numSamples) {
+		rampActive = false;
+
+		for (int start = 0; start < numSamples; start += controlInterval) {
+			auto n = std::min(controlInterval, numSamples - start);
+			auto target = cutoff[start + n - 1];
+			auto moved = hasMoved(target);
+
+			if (!rampActive) {
+				if (!moved) continue;
+				std::fill(gRamp.begin(), gRamp.begin() + start, g);
+				std::fill(hRamp.begin(), hRamp.begin() + start, h);
+				rampActive = true;
+			}
+
+			auto gStart = g;
+			auto gEnd = g;
+			if (moved) {
+				frequency = target;
+				gEnd = cutoffToG(frequency);
+			}
+
+			auto step = (gEnd - gStart) / static_cast<NumericType>(n);
+			for (int i = 0; i < n; ++i) {
+				auto gi = gStart + step * static_cast<NumericType>(i + 1);
+				gRamp[start + i] = gi;
+				hRamp[start + i] = gToH(gi);
+			}
+
+			g = gEnd;
+			h = gToH(g);
+		}
 	}
 
 	void processSample(int ch, T sample, T& sampleOutLow, T& sampleOutHigh) {
-		filter.processSample(ch, sample, sampleOutLow, sampleOutHigh);
+		tick(sample, sampleOutLow, sampleOutHigh, g, h, s1[ch], s2[ch], s3[ch], s4[ch]);
+	}
+
+	void processBlock(int ch, const T* input, T* outLow, T* outHigh, int numSamples) {
+		auto z1 = s1[ch], z2 = s2[ch], z3 = s3[ch], z4 = s4[ch];
+
+		if (rampActive) {
+			auto* gs = gRamp.data();
+			auto* hs = hRamp.data();
+			for (int s = 0; s < numSamples; ++s) {
+				tick(input[s], outLow[s], outHigh[s], gs[s], hs[s], z1, z2, z3, z4);
+			}
+		}
+		else {
+			auto gc = g, hc = h;
+			for (int s = 0; s < numSamples; ++s) {
+				tick(input[s], outLow[s], outHigh[s], gc, hc, z1, z2, z3, z4);
+			}
+		}
+
+		s1[ch] = z1; s2[ch] = z2; s3[ch] = z3; s4[ch] = z4;
+	}
+
+	// Low + high of an LR4 crossover is the 2nd order Butterworth allpass at the
+	// same cutoff, i.e. one SVF section. Running a signal that skipped this
+	// crossover through it keeps it in phase with the bands that went through.
+	// In-place (input == output) is fine.
+	void processAllpass(int ch, const T* input, T* output, int numSamples) {
+		auto z1 = a1[ch], z2 = a2[ch];
+
+		if (rampActive) {
+			auto* gs = gRamp.data();
+			auto* hs = hRamp.data();
+			for (int s = 0; s < numSamples; ++s) {
+				output[s] = allpassTick(input[s], gs[s], hs[s], z1, z2);
+			}
+		}
+		else {
+			auto gc = g, hc = h;
+			for (int s = 0; s < numSamples; ++s) {
+				output[s] = allpassTick(input[s], gc, hc, z1, z2);
+			}
+		}
+
+		a1[ch] = z1; a2[ch] = z2;
+	}
+
+private:
+	bool hasMoved(NumericType f) const {
+		return std::abs(f - frequency) > frequency * static_cast<NumericType>(CUTOFF_TOLERANCE);
+	}
+
+	NumericType cutoffToG(NumericType f) const {
+		auto nyquistSafe = static_cast<double>(sampleRate) * 0.49;
+		auto fc = std::min(std::max(static_cast<double>(f), 1.0), nyquistSafe);
+		return static_cast<NumericType>(std::tan(M_PI * fc / sampleRate));
+	}
+
+	NumericType gToH(NumericType gain) const {
+		return static_cast<NumericType>(1) / (static_cast<NumericType>(1) + R2 * gain + gain * gain);
+	}
+
+	// Vector operands stay on the left so the same code works for SIMDRegister.
+	inline void tick(T x, T& low, T& high, NumericType gc, NumericType hc, T& z1, T& z2, T& z3, T& z4) const {
+		auto yH = (x - z1 * (R2 + gc) - z2) * hc;
+		auto yB = yH * gc + z1;
+		z1 = yH * gc + yB;
+		auto yL = yB * gc + z2;
+		z2 = yB * gc + yL;
+
+		auto yH2 = (yL - z3 * (R2 + gc) - z4) * hc;
+		auto yB2 = yH2 * gc + z3;
+		z3 = yH2 * gc + yB2;
+		auto yL2 = yB2 * gc + z4;
+		z4 = yB2 * gc + yL2;
+
+		low = yL2;
+		high = yL - yB * R2 + yH - yL2;
+	}
+
+	inline T allpassTick(T x, NumericType gc, NumericType hc, T& z1, T& z2) const {
+		auto yH = (x - z1 * (R2 + gc) - z2) * hc;
+		auto yB = yH * gc + z1;
+		z1 = yH * gc + yB;
+		auto yL = yB * gc + z2;
+		z2 = yB * gc + yL;
+
+		return yL - yB * R2 + yH;
+	}
+};
+
+// Integer delay with one ring buffer per channel (or lane group). The delay
+// can be changed at any time up to the prepared maximum without allocating.
+template <typename T>
+struct DelayLine
+{
+	vector<T> buffer;
+	vector<int> writePosition;
+	int size{ 1 };
+	int delay{ 0 };
+
+	void prepare(int maxDelay, int numChannels) {
+		size = juce::nextPowerOfTwo(std::max(1, maxDelay + 1));
+		buffer.assign(static_cast<size_t>(size) * numChannels, static_cast<T>(0));
+		writePosition.assign(numChannels, 0);
+		delay = std::min(delay, size - 1);
+	}
+
+	void setDelay(int samples) {
+		delay = juce::jlimit(0, size - 1, samples);
+	}
+
+	int getDelay() const {
+		return delay;
+	}
+
+	void reset() {
+		std::fill(buffer.begin(), buffer.end(), static_cast<T>(0));
+	}
+
+	// Only channels first .. first + count - 1.
+	void reset(int first, int count) {
+		std::fill(buffer.begin() + first * size, buffer.begin() + (first + count) * size, static_cast<T>(0));
+	}
+
+	// In place. A delay of zero leaves data and the ring buffer untouched.
+	void process(int ch, T* data, int numSamples) {
+		if (delay == 0) return;
+
+		auto* ring = buffer.data() + ch * size;
+		auto mask = size - 1;
+		auto w = writePosition[ch];
+
+		for (int s = 0; s < numSamples; ++s) {
+			ring[w] = data[s];
+			data[s] = ring[(w - delay) & mask];
+			w = (w + 1) & mask;
+		}
+
+		writePosition[ch] = w;
 	}
 };
 
@@ -83,4 +306,6 @@ protected:
 
 
 #undef DEFAULT_SR
+#undef DEFAULT_CONTROL_INTERVAL
+#undef CUTOFF_TOLERANCE
 #undef M_PI
\ No newline at end of file
@@ -9,3 +9,841 @@
 */
 
 #pragma once
+
+#include <JuceHeader.h>
+#include <cmath>
+#include <vector>
+#include <atomic>
+#include <functional>
+using std::vector;
+
+#include "Analyzer.h"
+#include "Metering.h"
+#include "LookAndFeel.h"
+
+// Host parameter behind a ParameterNames entry.
+using ParameterLookup = std::function<juce::RangedAudioParameter&(int)>;
+
+inline float currentValue(const juce::RangedAudioParameter& parameter) {
+    return parameter.convertFrom0to1(parameter.getValue());
+}
+
+// Anything the editor's frame clock drives.
+class FrameClient
+{
+public:
+    virtual ~FrameClient() = default;
+
+    // Polls the data behind a display and repaints only what changed.
+    virtual void updateFrame() = 0;
+};
+
+// The one frame source of an editor, synced to the display's vertical blank.
+// Frames are dropped while the editor is not showing (hidden, minimised or
+// detached), so windows nobody looks at cost nothing.
+class FrameClock
+{
+    juce::Component& owner;
+    vector<FrameClient*> clients;
+    juce::VBlankAttachment vblank;
+
+    void tick() {
+        if (!owner.isShowing()) return;
+        for (auto* client : clients) client->updateFrame();
+    }
+
+public:
+
+    explicit FrameClock(juce::Component& editor)
+        : owner(editor), vblank(&editor, [this] { tick(); }) {}
+
+    void add(FrameClient& client) {
+        clients.push_back(&client);
+    }
+};
+
+// Image of a layer that rarely changes, kept at the screen's pixel density and
+// rendered again only after invalidate() or a change of size or scale.
+class CachedLayer
+{
+    juce::Image image;
+    float scale{ 0.0f };
+    bool valid{ false };
+
+public:
+
+    void invalidate() {
+        valid = false;
+    }
+
+    // render(graphics, area) draws the layer in component coordinates
+    // relative to area's origin.
+    template <typename Render>
+    void draw(juce::Graphics& g, juce::Rectangle<int> area, Render&& render) {
+        auto pixelScale = g.getInternalContext().getPhysicalPixelScaleFactor();
+        auto width = juce::roundToInt(static_cast<float>(area.getWidth()) * pixelScale);
+        auto height = juce::roundToInt(static_cast<float>(area.getHeight()) * pixelScale);
+        if (width <= 0 || height <= 0) return;
+
+        if (!valid || pixelScale != scale || image.getWidth() != width || image.getHeight() != height) {
+            if (image.getWidth() == width && image.getHeight() == height) image.clear(image.getBounds());
+            else image = juce::Image(juce::Image::ARGB, width, height, true);
+
+            juce::Graphics layer(image);
+            layer.addTransform(juce::AffineTransform::scale(pixelScale));
+            render(layer, area.withZeroOrigin());
+
+            scale = pixelScale;
+            valid = true;
+        }
+
+        g.drawImage(image, area.toFloat());
+    }
+};
+
+// Vertical bar meter. Remembers the pixel rows its bars end on and repaints
+// only the rows between the old and the new end of a bar that moved.
+class BarMeter : public juce::Component, public FrameClient
+{
+protected:
+
+    float minDb;
+    float maxDb;
+
+    BarMeter(float low, float high) : minDb(low), maxDb(high) {
+        setOpaque(true);
+    }
+
+    virtual juce::Rectangle<int> barArea() const {
+        return getLocalBounds();
+    }
+
+    void moveEdge(int& edge, int y) {
+        if (y == edge) return;
+        auto top = std::min(edge, y);
+        repaint(0, top - 1, getWidth(), std::max(edge, y) - top + 3);
+        edge = y;
+    }
+
+public:
+
+    // Row of a level, maxDb at the top of the bar area.
+    int dbToY(float db) const {
+        auto area = barArea();
+        auto position = (maxDb - juce::jlimit(minDb, maxDb, db)) / (maxDb - minDb);
+        return area.getY() + juce::roundToInt(position * static_cast<float>(area.getHeight()));
+    }
+};
+
+// Peak and RMS of one LevelMeter, with a clip light on top when given a clip
+// counter. Clicking the light resets it.
+class LevelMeterBar : public BarMeter
+{
+    static constexpr int clipHeight = 8;
+
+    const LevelMeter& meter;
+    const std::atomic<uint32_t>* clips;
+    uint32_t clipBaseline{ 0 };
+    bool clipped{ false };
+    int peakY{ 0 };
+    int rmsY{ 0 };
+
+    juce::Rectangle<int> clipArea() const {
+        return getLocalBounds().removeFromTop(clips != nullptr ? clipHeight : 0);
+    }
+
+    juce::Rectangle<int> barArea() const override {
+        return getLocalBounds().withTrimmedTop(clips != nullptr ? clipHeight + 2 : 0);
+    }
+
+public:
+
+    LevelMeterBar(const LevelMeter& source, const std::atomic<uint32_t>* clipCounter = nullptr)
+        : BarMeter(-60.0f, 6.0f), meter(source), clips(clipCounter) {
+        if (clips != nullptr) clipBaseline = clips->load(std::memory_order_relaxed);
+    }
+
+    void updateFrame() override {
+        moveEdge(peakY, dbToY(meter.peakDb.load(std::memory_order_relaxed)));
+        moveEdge(rmsY, dbToY(meter.rmsDb.load(std::memory_order_relaxed)));
+
+        if (clips != nullptr) {
+            auto isClipped = clips->load(std::memory_order_relaxed) != clipBaseline;
+            if (isClipped != clipped) {
+                clipped = isClipped;
+                repaint(clipArea());
+            }
+        }
+    }
+
+    void mouseDown(const juce::MouseEvent&) override {
+        if (clips == nullptr) return;
+        clipBaseline = clips->load(std::memory_order_relaxed);
+        clipped = false;
+        repaint(clipArea());
+    }
+
+    void resized() override {
+        peakY = rmsY = barArea().getBottom();
+    }
+
+    void paint(juce::Graphics& g) override {
+        g.fillAll(TrioColours::background);
+
+        auto area = barArea();
+        g.setColour(TrioColours::accent);
+        g.fillRect(area.withTop(rmsY));
+        g.setColour(TrioColours::peak);
+        g.fillRect(area.getX(), peakY, area.getWidth(), 2);
+
+        if (clips != nullptr) {
+            g.setColour(clipped ? TrioColours::clip : TrioColours::grid);
+            g.fillRect(clipArea());
+        }
+    }
+};
+
+// Gain reduction of one band, hanging down from 0 dB.
+class GainReductionBar : public BarMeter
+{
+    const BandMeter& meter;
+    juce::Colour colour;
+    int edge{ 0 };
+
+public:
+
+    GainReductionBar(const BandMeter& source, juce::Colour bandColour)
+        : BarMeter(-24.0f, 0.0f), meter(source), colour(bandColour) {}
+
+    void updateFrame() override {
+        moveEdge(edge, dbToY(meter.gainReductionDb.load(std::memory_order_relaxed)));
+    }
+
+    void resized() override {
+        edge = 0;
+    }
+
+    void paint(juce::Graphics& g) override {
+        g.fillAll(TrioColours::background);
+        g.setColour(colour);
+        g.fillRect(getLocalBounds().withBottom(edge));
+    }
+};
+
+// Static curve of one band with its operating point: the band input level
+// against the level after gain reduction. The curve is a cached layer redrawn
+// when threshold, ratio or knee change; while audio runs only the dot repaints.
+class TransferCurve : public juce::Component, public FrameClient
+{
+    static constexpr float minDb = -60.0f;
+    static constexpr float maxDb = 6.0f;
+    static constexpr int dotSize = 8;
+
+    const BandMeter& meter;
+    juce::RangedAudioParameter& threshold;
+    juce::RangedAudioParameter& ratio;
+    juce::RangedAudioParameter& knee;
+    juce::RangedAudioParameter& inputGain;
+    juce::RangedAudioParameter& detector;
+    juce::Colour colour;
+
+    CachedLayer curveLayer;
+    float drawnThreshold{ 0.0f };
+    float drawnRatio{ 1.0f };
+    float drawnKnee{ 0.0f };
+    juce::Point<int> dot{ -dotSize, -dotSize };
+
+    float dbToX(float db, float width) const {
+        return width * (db - minDb) / (maxDb - minDb);
+    }
+
+    float dbToY(float db, float height) const {
+        return height * (maxDb - db) / (maxDb - minDb);
+    }
+
+    juce::Rectangle<int> dotArea(juce::Point<int> centre) const {
+        return juce::Rectangle<int>(dotSize, dotSize).withCentre(centre).expanded(1);
+    }
+
+    float currentRatio() const {
+        if (auto* choice = dynamic_cast<const juce::AudioParameterChoice*>(&ratio))
+            return std::max(1.0f, choice->getCurrentChoiceName().getFloatValue());
+        return std::max(1.0f, currentValue(ratio));
+    }
+
+    void renderCurve(juce::Graphics& g, juce::Rectangle<int> area) const {
+        auto width = static_cast<float>(area.getWidth());
+        auto height = static_cast<float>(area.getHeight());
+
+        g.fillAll(TrioColours::background);
+
+        g.setColour(TrioColours::grid);
+        for (auto db = 0.0f; db > minDb; db -= 12.0f) {
+            g.drawVerticalLine(juce::roundToInt(dbToX(db, width)), 0.0f, height);
+            g.drawHorizontalLine(juce::roundToInt(dbToY(db, height)), 0.0f, width);
+        }
+        g.drawLine(0.0f, height, width, 0.0f);
+
+        // The engine's gain computer: straight below and above the knee,
+        // quadratic across it.
+        auto slope = 1.0f / drawnRatio - 1.0f;
+        auto output = [&](float in) {
+            auto excess = in - drawnThreshold;
+            if (drawnKnee <= 0.0f) return in + std::max(excess, 0.0f) * slope;
+            auto half = 0.5f * drawnKnee;
+            auto inKnee = juce::jlimit(0.0f, drawnKnee, excess + half);
+            return in + (inKnee * inKnee / (2.0f * drawnKnee) + std::max(excess - half, 0.0f)) * slope;
+        };
+
+        auto kneeStart = juce::jlimit(minDb, maxDb, drawnThreshold - 0.5f * drawnKnee);
+        auto kneeEnd = juce::jlimit(minDb, maxDb, drawnThreshold + 0.5f * drawnKnee);
+
+        juce::Path curve;
+        curve.startNewSubPath(0.0f, height);
+        curve.lineTo(dbToX(kneeStart, width), dbToY(output(kneeStart), height));
+        for (int i = 1; i <= 16 && kneeEnd > kneeStart; ++i) {
+            auto in = kneeStart + (kneeEnd - kneeStart) * static_cast<float>(i) / 16.0f;
+            curve.lineTo(dbToX(in, width), dbToY(output(in), height));
+        }
+        curve.lineTo(width, dbToY(output(maxDb), height));
+        g.setColour(colour);
+        g.strokePath(curve, juce::PathStrokeType(1.5f));
+    }
+
+public:
+
+    TransferCurve(const BandMeter& source, const ParameterLookup& parameter, int band, juce::Colour bandColour)
+        : meter(source),
+          threshold(parameter(THRESHOLD + band)),
+          ratio(parameter(RATIO + band)),
+          knee(parameter(KNEE + band)),
+          inputGain(parameter(BAND_INPUT + band)),
+          detector(parameter(DETECTOR + band)),
+          colour(bandColour) {
+        setOpaque(true);
+    }
+
+    void updateFrame() override {
+        auto t = currentValue(threshold);
+        auto r = currentRatio();
+        auto k = currentValue(knee);
+        if (t != drawnThreshold || r != drawnRatio || k != drawnKnee) {
+            drawnThreshold = t;
+            drawnRatio = r;
+            drawnKnee = k;
+            curveLayer.invalidate();
+            repaint();
+        }
+
+        auto level = detector.getValue() >= 0.5f ? meter.input.rmsDb.load(std::memory_order_relaxed)
+                                                  : meter.input.peakDb.load(std::memory_order_relaxed);
+        level += currentValue(inputGain);
+        auto reduced = level + meter.gainReductionDb.load(std::memory_order_relaxed);
+
+        auto next = juce::Point<int>(-dotSize, -dotSize);
+        if (level > minDb) {
+            next = juce::Point<int>(juce::roundToInt(dbToX(std::min(level, maxDb), static_cast<float>(getWidth()))),
+                                    juce::roundToInt(dbToY(juce::jlimit(minDb, maxDb, reduced), static_cast<float>(getHeight()))));
+        }
+
+        if (next != dot) {
+            repaint(dotArea(dot));
+            repaint(dotArea(next));
+            dot = next;
+        }
+    }
+
+    void resized() override {
+        curveLayer.invalidate();
+    }
+
+    void paint(juce::Graphics& g) override {
+        curveLayer.draw(g, getLocalBounds(), [this](juce::Graphics& layer, juce::Rectangle<int> area) {
+            renderCurve(layer, area);
+        });
+
+        g.setColour(colour.brighter(0.5f));
+        g.fillEllipse(dotArea(dot).reduced(1).toFloat());
+    }
+};
+
+// Owns a panel's controls and their parameter attachments, and lays out and
+// draws the caption above each control.
+class ControlSet
+{
+    struct Entry
+    {
+        juce::Component* control;
+        juce::String caption;
+        juce::Rectangle<int> captionArea;
+    };
+
+    static constexpr int captionHeight = 14;
+
+    juce::OwnedArray<juce::Component> controls;
+    vector<Entry> entries;
+
+    // Declared after the controls, so they are detached first.
+    juce::OwnedArray<juce::SliderParameterAttachment> sliderAttachments;
+    juce::OwnedArray<juce::ComboBoxParameterAttachment> comboAttachments;
+    juce::OwnedArray<juce::ButtonParameterAttachment> buttonAttachments;
+
+    template <typename Control>
+    Control& add(juce::Component& parent, Control* control, const juce::String& caption) {
+        controls.add(control);
+        entries.push_back({ control, caption, {} });
+        parent.addAndMakeVisible(control);
+        return *control;
+    }
+
+public:
+
+    juce::Slider& addKnob(juce::Component& parent, juce::RangedAudioParameter& parameter, const juce::String& caption) {
+        auto* slider = new juce::Slider(juce::Slider::RotaryHorizontalVerticalDrag, juce::Slider::TextBoxBelow);
+        slider->setTextBoxStyle(juce::Slider::TextBoxBelow, false, 64, 16);
+        sliderAttachments.add(new juce::SliderParameterAttachment(parameter, *slider, nullptr));
+        return add(parent, slider, caption);
+    }
+
+    juce::ComboBox& addChoice(juce::Component& parent, juce::RangedAudioParameter& parameter, const juce::String& caption) {
+        auto* box = new juce::ComboBox();
+        if (auto* choice = dynamic_cast<juce::AudioParameterChoice*>(&parameter)) box->addItemList(choice->choices, 1);
+        comboAttachments.add(new juce::ComboBoxParameterAttachment(parameter, *box, nullptr));
+        return add(parent, box, caption);
+    }
+
+    // The caption is the button text, not drawn above it.
+    juce::ToggleButton& addToggle(juce::Component& parent, juce::RangedAudioParameter& parameter, const juce::String& caption) {
+        auto* button = new juce::ToggleButton(caption);
+        buttonAttachments.add(new juce::ButtonParameterAttachment(parameter, *button, nullptr));
+        return add(parent, button, juce::String());
+    }
+
+    int size() const {
+        return static_cast<int>(entries.size());
+    }
+
+    // Puts control index in cell, under its caption.
+    void place(int index, juce::Rectangle<int> cell) {
+        auto& entry = entries[static_cast<size_t>(index)];
+        entry.captionArea = entry.caption.isEmpty() ? juce::Rectangle<int>() : cell.removeFromTop(captionHeight);
+        entry.control->setBounds(cell);
+    }
+
+    void drawCaptions(juce::Graphics& g) const {
+        g.setColour(TrioColours::dimText);
+        g.setFont(12.0f);
+        for (auto& entry : entries) {
+            if (!entry.captionArea.isEmpty()) g.drawText(entry.caption, entry.captionArea, juce::Justification::centred, true);
+        }
+    }
+};
+
+// Input and output spectra on a log frequency axis with the output peak hold,
+// and a draggable handle per crossover. The grid and the handles are cached
+// layers; a new spectrum repaints only the rows its curves cover, a moved
+// crossover only the strips around its old and new positions.
+class SpectrumDisplay : public juce::Component, public FrameClient
+{
+    static constexpr float minFrequency = 20.0f;
+    static constexpr float maxFrequency = 20000.0f;
+    static constexpr float minDb = -96.0f;
+    static constexpr float maxDb = 6.0f;
+    static constexpr int handleHalfWidth = 28;
+    static constexpr int handleHeight = 16;
+
+    SpectrumAnalyzer& analyzer;
+    vector<juce::RangedAudioParameter*> crossovers;
+    vector<float> drawnCrossovers;
+    int dragging{ -1 };
+
+    juce::Path inputPath, outputPath, peakPath;
+    juce::Rectangle<int> curveArea;
+
+    CachedLayer gridLayer;
+    CachedLayer handleLayer;
+
+    float frequencyToX(float frequency) const {
+        return static_cast<float>(getWidth()) * std::log(frequency / minFrequency) / std::log(maxFrequency / minFrequency);
+    }
+
+    float xToFrequency(float x) const {
+        return minFrequency * std::exp(x / static_cast<float>(std::max(1, getWidth())) * std::log(maxFrequency / minFrequency));
+    }
+
+    float dbToY(float db) const {
+        auto clamped = juce::jlimit(minDb, maxDb, db);
+        return static_cast<float>(getHeight()) * (maxDb - clamped) / (maxDb - minDb);
+    }
+
+    static juce::String frequencyText(float frequency) {
+        return frequency < 1000.0f ? juce::String(juce::roundToInt(frequency))
+                                   : juce::String(frequency / 1000.0f, 1) + "k";
+    }
+
+    // One point per pixel column, the loudest bin that lands in it. Returns
+    // the highest point of the curve.
+    float buildPath(juce::Path& path, const std::array<float, analyzerBins>& db, float binWidth, bool closed) const {
+        path.clear();
+        path.preallocateSpace(3 * getWidth() + 12);
+
+        auto bottom = static_cast<float>(getHeight());
+        auto highest = bottom;
+        auto started = false;
+        auto column = -1;
+        auto loudest = minDb;
+
+        for (int bin = 1; bin < analyzerBins; ++bin) {
+            auto frequency = bin * binWidth;
+            if (frequency < minFrequency) continue;
+            if (frequency > maxFrequency) break;
+
+            auto x = static_cast<int>(frequencyToX(frequency));
+            if (x == column) {
+                loudest = std::max(loudest, db[bin]);
+                continue;
+            }
+
+            if (column >= 0) {
+                if (!started) {
+                    path.startNewSubPath(static_cast<float>(column), closed ? bottom : dbToY(loudest));
+                    started = true;
+                }
+                path.lineTo(static_cast<float>(column), dbToY(loudest));
+                highest = std::min(highest, dbToY(loudest));
+            }
+            column = x;
+            loudest = db[bin];
+        }
+
+        if (!started) return highest;
+        path.lineTo(static_cast<float>(column), dbToY(loudest));
+        if (closed) {
+            path.lineTo(static_cast<float>(column), bottom);
+            path.closeSubPath();
+        }
+        return std::min(highest, dbToY(loudest));
+    }
+
+    // Rows from the highest curve point down to the bottom.
+    juce::Rectangle<int> buildPaths() {
+        const auto& spectrum = analyzer.getSpectra().read();
+        auto binWidth = spectrum.sampleRate / analyzerSize;
+
+        auto top = buildPath(outputPath, spectrum.output, binWidth, true);
+        top = std::min(top, buildPath(inputPath, spectrum.input, binWidth, false));
+        top = std::min(top, buildPath(peakPath, spectrum.outputPeak, binWidth, false));
+
+        return getLocalBounds().withTop(static_cast<int>(top) - 2);
+    }
+
+    juce::Rectangle<int> handleArea(float frequency) const {
+        auto x = juce::roundToInt(frequencyToX(frequency));
+        return juce::Rectangle<int>(x - handleHalfWidth, 0, 2 * handleHalfWidth, getHeight());
+    }
+
+    int handleAt(float x) const {
+        for (size_t i = 0; i < drawnCrossovers.size(); ++i) {
+            if (std::abs(frequencyToX(drawnCrossovers[i]) - x) < 6.0f) return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    void renderGrid(juce::Graphics& g, juce::Rectangle<int> area) const {
+        auto width = static_cast<float>(area.getWidth());
+        auto height = static_cast<float>(area.getHeight());
+
+        g.fillAll(TrioColours::panel);
+        g.setFont(11.0f);
+
+        for (auto frequency : { 50.0f, 100.0f, 200.0f, 500.0f, 1000.0f, 2000.0f, 5000.0f, 10000.0f }) {
+            auto x = juce::roundToInt(frequencyToX(frequency));
+            g.setColour(TrioColours::grid);
+            g.drawVerticalLine(x, 0.0f, height);
+            g.setColour(TrioColours::dimText);
+            g.drawText(frequencyText(frequency), x + 3, area.getBottom() - 14, 40, 12, juce::Justification::left, false);
+        }
+        for (auto db = 0.0f; db > minDb; db -= 12.0f) {
+            auto y = juce::roundToInt(dbToY(db));
+            g.setColour(TrioColours::grid);
+            g.drawHorizontalLine(y, 0.0f, width);
+            g.setColour(TrioColours::dimText);
+            g.drawText(juce::String(juce::roundToInt(db)), 3, y + 1, 30, 12, juce::Justification::left, false);
+        }
+    }
+
+    void renderHandles(juce::Graphics& g, juce::Rectangle<int> area) const {
+        auto height = static_cast<float>(area.getHeight());
+        g.setFont(11.0f);
+
+        for (auto frequency : drawnCrossovers) {
+            auto x = frequencyToX(frequency);
+            g.setColour(TrioColours::text.withAlpha(0.5f));
+            g.drawLine(x, static_cast<float>(handleHeight), x, height, 1.0f);
+
+            auto box = juce::Rectangle<float>(x - 20.0f, 1.0f, 40.0f, static_cast<float>(handleHeight - 2));
+            g.setColour(TrioColours::grid);
+            g.fillRoundedRectangle(box, 3.0f);
+            g.setColour(TrioColours::text);
+            g.drawText(frequencyText(frequency), box, juce::Justification::centred, false);
+        }
+    }
+
+public:
+
+    SpectrumDisplay(SpectrumAnalyzer& source, vector<juce::RangedAudioParameter*> crossoverParameters)
+        : analyzer(source), crossovers(std::move(crossoverParameters)) {
+        setOpaque(true);
+        drawnCrossovers.assign(crossovers.size(), minFrequency);
+        analyzer.setActive(true);
+    }
+
+    ~SpectrumDisplay() override {
+        analyzer.setActive(false);
+    }
+
+    void updateFrame() override {
+        for (size_t i = 0; i < crossovers.size(); ++i) {
+            auto frequency = currentValue(*crossovers[i]);
+            if (frequency == drawnCrossovers[i]) continue;
+
+            repaint(handleArea(drawnCrossovers[i]));
+            repaint(handleArea(frequency));
+            drawnCrossovers[i] = frequency;
+            handleLayer.invalidate();
+        }
+
+        if (!analyzer.getSpectra().update()) return;
+
+        auto area = buildPaths();
+        repaint(area.getUnion(curveArea));
+        curveArea = area;
+    }
+
+    void resized() override {
+        gridLayer.invalidate();
+        handleLayer.invalidate();
+        curveArea = buildPaths();
+    }
+
+    void paint(juce::Graphics& g) override {
+        gridLayer.draw(g, getLocalBounds(), [this](juce::Graphics& layer, juce::Rectangle<int> area) {
+            renderGrid(layer, area);
+        });
+
+        g.setColour(TrioColours::accent.withAlpha(0.6f));
+        g.fillPath(outputPath);
+
+        g.setColour(TrioColours::text.withAlpha(0.7f));
+        g.strokePath(inputPath, juce::PathStrokeType(1.0f));
+
+        g.setColour(TrioColours::peak);
+        g.strokePath(peakPath, juce::PathStrokeType(1.0f));
+
+        handleLayer.draw(g, getLocalBounds(), [this](juce::Graphics& layer, juce::Rectangle<int> area) {
+            renderHandles(layer, area);
+        });
+    }
+
+    void mouseMove(const juce::MouseEvent& e) override {
+        setMouseCursor(handleAt(e.position.x) >= 0 ? juce::MouseCursor::LeftRightResizeCursor
+                                                   : juce::MouseCursor::NormalCursor);
+    }
+
+    void mouseDown(const juce::MouseEvent& e) override {
+        dragging = handleAt(e.position.x);
+        if (dragging >= 0) crossovers[static_cast<size_t>(dragging)]->beginChangeGesture();
+    }
+
+    // Crossovers stay in order: a handle stops at its neighbours.
+    void mouseDrag(const juce::MouseEvent& e) override {
+        if (dragging < 0) return;
+
+        auto i = static_cast<size_t>(dragging);
+        auto lower = i > 0 ? drawnCrossovers[i - 1] : minFrequency;
+        auto upper = i + 1 < drawnCrossovers.size() ? drawnCrossovers[i + 1] : maxFrequency;
+        auto frequency = juce::jlimit(lower, upper, xToFrequency(e.position.x));
+
+        auto* parameter = crossovers[i];
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(frequency));
+    }
+
+    void mouseUp(const juce::MouseEvent&) override {
+        if (dragging >= 0) crossovers[static_cast<size_t>(dragging)]->endChangeGesture();
+        dragging = -1;
+    }
+};
+
+// Controls, transfer curve and gain reduction meter of one band. The panel
+// background and captions are a cached layer, so while audio runs only the
+// curve's operating point and the meter repaint.
+class BandPanel : public juce::Component, public FrameClient
+{
+    juce::String title;
+    juce::Colour colour;
+
+    TransferCurve curve;
+    GainReductionBar reduction;
+    ControlSet controls;
+    CachedLayer background;
+
+    void renderBackground(juce::Graphics& g, juce::Rectangle<int> area) const {
+        g.fillAll(TrioColours::panel);
+        g.setColour(colour);
+        g.fillRect(area.removeFromTop(3));
+
+        g.setColour(TrioColours::text);
+        g.setFont(14.0f);
+        g.drawText(title, area.reduced(8, 0).removeFromTop(24), juce::Justification::centredLeft, false);
+
+        controls.drawCaptions(g);
+    }
+
+public:
+
+    static constexpr int preferredWidth = 160;
+    static constexpr int preferredHeight = 564;
+
+    BandPanel(const juce::String& name, juce::Colour bandColour, const BandMeter& meter,
+              const ParameterLookup& parameter, int band)
+        : title(name), colour(bandColour),
+          curve(meter, parameter, band, bandColour),
+          reduction(meter, bandColour) {
+        setOpaque(true);
+        addAndMakeVisible(curve);
+        addAndMakeVisible(reduction);
+
+        controls.addToggle(*this, parameter(MUTE + band), "Mute");
+        controls.addKnob(*this, parameter(THRESHOLD + band), "Threshold");
+        controls.addChoice(*this, parameter(RATIO + band), "Ratio");
+        controls.addKnob(*this, parameter(KNEE + band), "Knee");
+        controls.addKnob(*this, parameter(ATTACK + band), "Attack");
+        controls.addKnob(*this, parameter(RELEASE + band), "Release");
+        controls.addKnob(*this, parameter(BAND_INPUT + band), "Input");
+        controls.addKnob(*this, parameter(BAND_OUTPUT + band), "Output");
+        controls.addKnob(*this, parameter(LOOKAHEAD + band), "Lookahead");
+        controls.addKnob(*this, parameter(RMS_WINDOW + band), "RMS Window");
+        controls.addChoice(*this, parameter(DETECTOR + band), "Detector");
+        controls.addChoice(*this, parameter(OVERSAMPLING + band), "Oversampling");
+    }
+
+    void updateFrame() override {
+        curve.updateFrame();
+        reduction.updateFrame();
+    }
+
+    // Mute in the title row; threshold and ratio side by side, then the
+    // remaining knobs two per row and the choices full width.
+    void resized() override {
+        auto area = getLocalBounds().withTrimmedTop(3).reduced(6, 0);
+
+        controls.place(0, area.removeFromTop(24).removeFromRight(64));
+
+        auto top = area.removeFromTop(110);
+        reduction.setBounds(top.removeFromRight(8));
+        top.removeFromRight(4);
+        curve.setBounds(top);
+        area.removeFromTop(6);
+
+        auto row = area.removeFromTop(68);
+        controls.place(1, row.removeFromLeft(row.getWidth() / 2));
+        controls.place(2, row.withSizeKeepingCentre(row.getWidth() - 8, 36));
+
+        for (int i = 3; i < 10; i += 2) {
+            row = area.removeFromTop(68);
+            controls.place(i, row.removeFromLeft(row.getWidth() / 2));
+            if (i + 1 < 10) controls.place(i + 1, row);
+        }
+
+        for (int i = 10; i < controls.size(); ++i) {
+            controls.place(i, area.removeFromTop(38).withTrimmedBottom(2));
+        }
+
+        background.invalidate();
+    }
+
+    void paint(juce::Graphics& g) override {
+        background.draw(g, getLocalBounds(), [this](juce::Graphics& layer, juce::Rectangle<int> area) {
+            renderBackground(layer, area);
+        });
+    }
+};
+
+// Global gain, bypass and mode controls next to the input and output meters.
+class GlobalPanel : public juce::Component, public FrameClient
+{
+    LevelMeterBar inputMeter;
+    LevelMeterBar outputMeter;
+    ControlSet controls;
+    CachedLayer background;
+
+    void renderBackground(juce::Graphics& g, juce::Rectangle<int>) const {
+        g.fillAll(TrioColours::panel);
+        controls.drawCaptions(g);
+
+        g.setFont(11.0f);
+        for (auto* meter : { &inputMeter, &outputMeter }) {
+            g.setColour(TrioColours::dimText);
+            g.drawText(meter == &inputMeter ? "In" : "Out", meter->getX() - 4, meter->getBottom() + 2,
+                       meter->getWidth() + 8, 12, juce::Justification::centred, false);
+        }
+        for (auto db = 0.0f; db >= -60.0f; db -= 12.0f) {
+            auto y = inputMeter.getY() + inputMeter.dbToY(db);
+            g.drawText(juce::String(juce::roundToInt(db)), inputMeter.getRight(), y - 6,
+                       outputMeter.getX() - inputMeter.getRight(), 12, juce::Justification::centred, false);
+        }
+    }
+
+public:
+
+    static constexpr int preferredWidth = 170;
+
+    GlobalPanel(const EngineMeters& meters, const ParameterLookup& parameter)
+        : inputMeter(meters.input, &meters.inputClips),
+          outputMeter(meters.output, &meters.outputClips) {
+        setOpaque(true);
+        addAndMakeVisible(inputMeter);
+        addAndMakeVisible(outputMeter);
+
+        controls.addToggle(*this, parameter(BYPASS), "Bypass");
+        controls.addKnob(*this, parameter(INPUT_ALL), "Input");
+        controls.addKnob(*this, parameter(OUTPUT_ALL), "Output");
+        controls.addChoice(*this, parameter(LINK_MODE), "Link Mode");
+        controls.addChoice(*this, parameter(CROSSOVER_MODE), "Crossover");
+    }
+
+    void updateFrame() override {
+        inputMeter.updateFrame();
+        outputMeter.updateFrame();
+    }
+
+    void resized() override {
+        auto area = getLocalBounds().reduced(8);
+
+        controls.place(0, area.removeFromTop(24));
+        area.removeFromTop(6);
+
+        auto meters = area.removeFromTop(std::max(120, area.getHeight() - 68 - 2 * 38 - 24));
+        meters.removeFromBottom(16);
+        meters = meters.withSizeKeepingCentre(64, meters.getHeight());
+        inputMeter.setBounds(meters.removeFromLeft(14));
+        outputMeter.setBounds(meters.removeFromRight(14));
+        area.removeFromTop(8);
+
+        auto row = area.removeFromTop(68);
+        controls.place(1, row.removeFromLeft(row.getWidth() / 2));
+        controls.place(2, row);
+
+        for (int i = 3; i < controls.size(); ++i) {
+            controls.place(i, area.removeFromTop(38).withTrimmedBottom(2));
+        }
+
+        background.invalidate();
+    }
+
+    void paint(juce::Graphics& g) override {
+        background.draw(g, getLocalBounds(), [this](juce::Graphics& layer, juce::Rectangle<int> area) {
+            renderBackground(layer, area);
+        });
+    }
+};
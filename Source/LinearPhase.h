@@ -0,0 +1,422 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+using std::vector;
+
+#include "Utils.h"
+
+// Kernel partitions; the partition length grows with the sample rate so the
+// kernel, and with it the frequency resolution, covers the same time at any rate.
+#define NUM_PARTITIONS 16
+#define BASE_PARTITION_SIZE 512
+#define KAISER_BETA 8.0
+#define KERNEL_POLL_MS 20
+
+// Crossover modes, in the order of the "Crossover Mode" choices.
+enum class CrossoverMode { iir, linearPhase };
+
+// Linear phase band split by uniformly partitioned FFT convolution (overlap-save).
+// Each band kernel is the difference of two windowed-sinc lowpasses (the lowest
+// band is a lowpass, the highest a delta minus one), so the bands add up to the
+// input delayed by half the kernel. The input spectrum history is shared by
+// every band: one forward FFT per channel and partition, then a complex
+// multiply-add over the partitions and one inverse FFT per band.
+//
+// Kernels are designed on a background thread whenever a cutoff changes and
+// handed over through a lock-free mailbox; the audio thread picks them up at a
+// partition boundary and crossfades from the old kernels over one partition.
+// The buffers and the worker only exist once linear phase is in use: enable()
+// sets them up, from prepare() or, when the audio thread asks for it with
+// requestEnable(), on the message thread.
+template <int NumBands>
+class LinearPhaseCrossover : private juce::Thread, private juce::AsyncUpdater
+{
+	static constexpr int numCrossovers = NumBands - 1;
+
+	// Kernel slots: the audio thread owns active and spare (the previous
+	// kernels, kept for the crossfade), the worker owns building, and `ready`
+	// is the mailbox between them, with newKernels set until it is picked up.
+	static constexpr int numSlots = 4;
+	static constexpr int slotMask = 3;
+	static constexpr int newKernels = 4;
+
+	// Per band, NUM_PARTITIONS partitions of numBins bins each.
+	struct Kernels
+	{
+		std::array<vector<float>, NumBands> real;
+		std::array<vector<float>, NumBands> imag;
+	};
+
+	float sampleRate{ 44100.0f };
+	int partitionSize{ BASE_PARTITION_SIZE };
+	int fftSize{ 2 * BASE_PARTITION_SIZE };
+	int numBins{ BASE_PARTITION_SIZE + 1 };
+	int kernelLength{ 1 };
+	int nChannels{ 0 };
+
+	std::array<Kernels, numSlots> slots;
+	std::atomic<int> ready{ 2 };
+	int active{ 0 };
+	int spare{ 1 };
+	int building{ 3 };
+
+	std::array<std::atomic<float>, numCrossovers> requestedCutoffs{};
+	std::atomic<int> requestedVersion{ 0 };
+	int designedVersion{ 0 };
+
+	// Set once the buffers and the first kernels are in place and the worker
+	// runs; the audio thread leaves everything below alone until then.
+	std::atomic<bool> enabled{ false };
+
+	// Used by whichever thread designs kernels: enable() or the worker.
+	std::unique_ptr<juce::dsp::FFT> designFft;
+	vector<double> window;
+	vector<double> lowpass;
+	vector<double> previousLowpass;
+	vector<float> designScratch;
+
+	// Audio thread. Per lane group: the last two partitions of input, a ring of
+	// NUM_PARTITIONS input spectra, and one partition of output per band.
+	std::unique_ptr<juce::dsp::FFT> fft;
+	vector<SIMDFloat> history;
+	vector<SIMDFloat> spectraReal;
+	vector<SIMDFloat> spectraImag;
+	std::array<vector<SIMDFloat>, NumBands> outputs;
+	vector<SIMDFloat> sumReal;
+	vector<SIMDFloat> sumImag;
+	vector<SIMDFloat> fadeBuffer;
+	vector<float> laneScratch;
+	int position{ 0 };
+	int head{ 0 };
+
+	SIMDFloat* historySlice(int group) {
+		return history.data() + group * fftSize;
+	}
+
+	SIMDFloat* outputSlice(int band, int group) {
+		return outputs[band].data() + group * partitionSize;
+	}
+
+	int lanesInGroup(int group) const {
+		return std::min(simdLanes, nChannels - group * simdLanes);
+	}
+
+	// Windowed sinc with unity gain at DC, centred on the middle tap.
+	void designLowpass(float cutoff, vector<double>& h) const {
+		auto centre = (kernelLength - 1) / 2;
+		auto w = 2.0 * juce::jlimit(1.0, 0.49 * sampleRate, static_cast<double>(cutoff)) / sampleRate;
+
+		double sum = 0.0;
+		for (int n = 0; n < kernelLength; ++n) {
+			auto x = juce::MathConstants<double>::pi * w * (n - centre);
+			h[n] = (n == centre ? w : w * std::sin(x) / x) * window[n];
+			sum += h[n];
+		}
+		for (int n = 0; n < kernelLength; ++n) h[n] /= sum;
+	}
+
+	void design(Kernels& kernels, const float* cutoffs) {
+		auto centre = (kernelLength - 1) / 2;
+		std::fill(previousLowpass.begin(), previousLowpass.end(), 0.0);
+
+		for (int b = 0; b < NumBands; ++b) {
+			if (b < numCrossovers) {
+				designLowpass(cutoffs[b], lowpass);
+			}
+			else {
+				std::fill(lowpass.begin(), lowpass.end(), 0.0);
+				lowpass[centre] = 1.0;
+			}
+
+			for (int k = 0; k < NUM_PARTITIONS; ++k) {
+				std::fill(designScratch.begin(), designScratch.end(), 0.0f);
+				for (int i = 0; i < partitionSize; ++i) {
+					auto n = k * partitionSize + i;
+					if (n < kernelLength) designScratch[i] = static_cast<float>(lowpass[n] - previousLowpass[n]);
+				}
+
+				designFft->performRealOnlyForwardTransform(designScratch.data(), true);
+
+				auto* re = kernels.real[b].data() + k * numBins;
+				auto* im = kernels.imag[b].data() + k * numBins;
+				for (int bin = 0; bin < numBins; ++bin) {
+					re[bin] = designScratch[2 * bin];
+					im[bin] = designScratch[2 * bin + 1];
+				}
+			}
+
+			std::swap(lowpass, previousLowpass);
+		}
+	}
+
+	void run() override {
+		while (!threadShouldExit()) {
+			auto version = requestedVersion.load(std::memory_order_acquire);
+			if (version == designedVersion) {
+				wait(KERNEL_POLL_MS);
+				continue;
+			}
+
+			designedVersion = version;
+			float cutoffs[numCrossovers];
+			for (int i = 0; i < numCrossovers; ++i) cutoffs[i] = requestedCutoffs[i].load(std::memory_order_relaxed);
+
+			design(slots[building], cutoffs);
+			building = ready.exchange(building | newKernels, std::memory_order_acq_rel) & slotMask;
+		}
+	}
+
+	void handleAsyncUpdate() override {
+		enable();
+	}
+
+	// Hands the spare slot back to the worker and keeps the outgoing kernels
+	// as the new spare, so both can be used for the crossfade.
+	bool takeNewKernels() {
+		if ((ready.load(std::memory_order_relaxed) & newKernels) == 0) return false;
+
+		auto previous = active;
+		active = ready.exchange(spare, std::memory_order_acq_rel) & slotMask;
+		spare = previous;
+		return true;
+	}
+
+	void forwardTransform(int group) {
+		auto* frame = toFloatPointer(historySlice(group));
+		auto* re = toFloatPointer(spectraReal.data() + (group * NUM_PARTITIONS + head) * numBins);
+		auto* im = toFloatPointer(spectraImag.data() + (group * NUM_PARTITIONS + head) * numBins);
+
+		for (int l = 0; l < lanesInGroup(group); ++l) {
+			for (int i = 0; i < fftSize; ++i) laneScratch[i] = frame[i * simdLanes + l];
+
+			fft->performRealOnlyForwardTransform(laneScratch.data(), true);
+
+			for (int bin = 0; bin < numBins; ++bin) {
+				re[bin * simdLanes + l] = laneScratch[2 * bin];
+				im[bin * simdLanes + l] = laneScratch[2 * bin + 1];
+			}
+		}
+	}
+
+	// Input spectrum k partitions back times kernel partition k, summed, then
+	// the last partition of the inverse transform (overlap-save).
+	void convolve(int group, const Kernels& kernels, int band, SIMDFloat* output) {
+		std::fill(sumReal.begin(), sumReal.end(), SIMDFloat(0.0f));
+		std::fill(sumImag.begin(), sumImag.end(), SIMDFloat(0.0f));
+		auto* accRe = sumReal.data();
+		auto* accIm = sumImag.data();
+
+		for (int k = 0; k < NUM_PARTITIONS; ++k) {
+			auto slot = (head - k + NUM_PARTITIONS) % NUM_PARTITIONS;
+			auto* xRe = spectraReal.data() + (group * NUM_PARTITIONS + slot) * numBins;
+			auto* xIm = spectraImag.data() + (group * NUM_PARTITIONS + slot) * numBins;
+			auto* hRe = kernels.real[band].data() + k * numBins;
+			auto* hIm = kernels.imag[band].data() + k * numBins;
+
+			for (int bin = 0; bin < numBins; ++bin) {
+				accRe[bin] = accRe[bin] + xRe[bin] * hRe[bin] - xIm[bin] * hIm[bin];
+				accIm[bin] = accIm[bin] + xRe[bin] * hIm[bin] + xIm[bin] * hRe[bin];
+			}
+		}
+
+		auto* re = toFloatPointer(accRe);
+		auto* im = toFloatPointer(accIm);
+		auto* out = toFloatPointer(output);
+
+		for (int l = 0; l < lanesInGroup(group); ++l) {
+			for (int bin = 0; bin < numBins; ++bin) {
+				laneScratch[2 * bin] = re[bin * simdLanes + l];
+				laneScratch[2 * bin + 1] = im[bin * simdLanes + l];
+			}
+
+			fft->performRealOnlyInverseTransform(laneScratch.data());
+
+			for (int i = 0; i < partitionSize; ++i) out[i * simdLanes + l] = laneScratch[partitionSize + i];
+		}
+	}
+
+	void processPartition(int groups) {
+		auto crossfade = takeNewKernels();
+		head = (head + 1) % NUM_PARTITIONS;
+
+		for (int group = 0; group < groups; ++group) {
+			forwardTransform(group);
+
+			for (int b = 0; b < NumBands; ++b) {
+				auto* out = outputSlice(b, group);
+				convolve(group, slots[active], b, out);
+
+				if (crossfade) {
+					auto* old = fadeBuffer.data();
+					std::fill(fadeBuffer.begin(), fadeBuffer.end(), SIMDFloat(0.0f));
+					convolve(group, slots[spare], b, old);
+
+					auto step = 1.0f / static_cast<float>(partitionSize);
+					for (int i = 0; i < partitionSize; ++i) {
+						out[i] = old[i] + (out[i] - old[i]) * (step * static_cast<float>(i + 1));
+					}
+				}
+			}
+
+			auto* frame = historySlice(group);
+			std::copy(frame + partitionSize, frame + fftSize, frame);
+		}
+	}
+
+public:
+
+	LinearPhaseCrossover() : juce::Thread("Linear Phase Kernels") {}
+
+	~LinearPhaseCrossover() override {
+		stopThread(1000);
+	}
+
+	// Sizes the split for the sample rate, so getLatency() holds in either
+	// mode, and enables it right away if linear phase is in use.
+	void prepare(float sr, int numChannels, const float* cutoffs, bool inUse) {
+		cancelPendingUpdate();
+		stopThread(1000);
+		enabled.store(false);
+
+		sampleRate = sr;
+		nChannels = numChannels;
+		auto scale = juce::nextPowerOfTwo(std::max(1, juce::roundToInt(sampleRate / 48000.0f)));
+		partitionSize = BASE_PARTITION_SIZE * scale;
+		fftSize = 2 * partitionSize;
+		numBins = partitionSize + 1;
+		kernelLength = NUM_PARTITIONS * partitionSize - 1;
+
+		for (int i = 0; i < numCrossovers; ++i) requestedCutoffs[i].store(cutoffs[i]);
+
+		if (inUse) enable();
+	}
+
+	// Allocates the buffers, designs the kernels for the stored cutoffs
+	// before returning and starts the worker for later changes. Not for the
+	// audio thread; does nothing once enabled.
+	void enable() {
+		if (enabled.load()) return;
+
+		auto order = 0;
+		while ((1 << order) < fftSize) ++order;
+		fft = std::make_unique<juce::dsp::FFT>(order);
+		designFft = std::make_unique<juce::dsp::FFT>(order);
+
+		window.resize(kernelLength);
+		for (int n = 0; n < kernelLength; ++n) {
+			auto x = 2.0 * n / (kernelLength - 1) - 1.0;
+			window[n] = besselI0(KAISER_BETA * std::sqrt(1.0 - x * x)) / besselI0(KAISER_BETA);
+		}
+		lowpass.assign(kernelLength, 0.0);
+		previousLowpass.assign(kernelLength, 0.0);
+		designScratch.assign(2 * fftSize, 0.0f);
+
+		for (auto& slot : slots) {
+			for (int b = 0; b < NumBands; ++b) {
+				slot.real[b].assign(static_cast<size_t>(NUM_PARTITIONS) * numBins, 0.0f);
+				slot.imag[b].assign(static_cast<size_t>(NUM_PARTITIONS) * numBins, 0.0f);
+			}
+		}
+
+		auto groups = static_cast<size_t>(numLaneGroups(nChannels));
+		history.assign(groups * fftSize, SIMDFloat(0.0f));
+		spectraReal.assign(groups * NUM_PARTITIONS * numBins, SIMDFloat(0.0f));
+		spectraImag.assign(groups * NUM_PARTITIONS * numBins, SIMDFloat(0.0f));
+		for (auto& output : outputs) output.assign(groups * partitionSize, SIMDFloat(0.0f));
+		sumReal.assign(numBins, SIMDFloat(0.0f));
+		sumImag.assign(numBins, SIMDFloat(0.0f));
+		fadeBuffer.assign(partitionSize, SIMDFloat(0.0f));
+		laneScratch.assign(2 * fftSize, 0.0f);
+		position = 0;
+		head = 0;
+
+		designedVersion = requestedVersion.load();
+		float cutoffs[numCrossovers];
+		for (int i = 0; i < numCrossovers; ++i) cutoffs[i] = requestedCutoffs[i].load();
+		design(slots[0], cutoffs);
+
+		active = 0;
+		spare = 1;
+		building = 3;
+		ready.store(2);
+
+		startThread();
+		enabled.store(true, std::memory_order_release);
+	}
+
+	// Safe to call from the audio thread: enable() follows on the message thread.
+	void requestEnable() {
+		triggerAsyncUpdate();
+	}
+
+	bool isEnabled() const {
+		return enabled.load(std::memory_order_acquire);
+	}
+
+	// Stops the worker; the buffers and kernels stay until the next prepare().
+	void release() {
+		cancelPendingUpdate();
+		stopThread(1000);
+	}
+
+	void reset() {
+		if (!isEnabled()) return;
+		std::fill(history.begin(), history.end(), SIMDFloat(0.0f));
+		std::fill(spectraReal.begin(), spectraReal.end(), SIMDFloat(0.0f));
+		std::fill(spectraImag.begin(), spectraImag.end(), SIMDFloat(0.0f));
+		for (auto& output : outputs) std::fill(output.begin(), output.end(), SIMDFloat(0.0f));
+		position = 0;
+	}
+
+	// Safe to call from the audio thread: only stores the target, for the
+	// next redesign() or enable().
+	void setCutoff(int index, float frequency) {
+		requestedCutoffs[index].store(frequency, std::memory_order_relaxed);
+	}
+
+	// Has the worker design kernels for the stored cutoffs; the audio thread
+	// crossfades to them over one partition.
+	void redesign() {
+		requestedVersion.fetch_add(1, std::memory_order_release);
+	}
+
+	// Half the kernel plus one partition of buffering, in samples.
+	int getLatency() const {
+		return (kernelLength - 1) / 2 + partitionSize;
+	}
+
+	// Lane group g of the input and of each band output starts at g * stride.
+	void process(const SIMDFloat* input, SIMDFloat* const* bands, int stride, int groups, int numSamples) {
+		for (int done = 0; done < numSamples;) {
+			auto n = std::min(numSamples - done, partitionSize - position);
+
+			for (int group = 0; group < groups; ++group) {
+				auto* in = input + group * stride + done;
+				std::copy(in, in + n, historySlice(group) + partitionSize + position);
+
+				for (int b = 0; b < NumBands; ++b) {
+					auto* out = outputSlice(b, group) + position;
+					std::copy(out, out + n, bands[b] + group * stride + done);
+				}
+			}
+
+			position += n;
+			done += n;
+
+			if (position == partitionSize) {
+				processPartition(groups);
+				position = 0;
+			}
+		}
+	}
+};
+
+#undef NUM_PARTITIONS
+#undef BASE_PARTITION_SIZE
+#undef KAISER_BETA
+#undef KERNEL_POLL_MS
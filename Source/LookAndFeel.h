@@ -9,3 +9,79 @@
 */
 
 #pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+
+namespace TrioColours
+{
+    const juce::Colour background{ 0xff101316 };
+    const juce::Colour panel{ 0xff15181c };
+    const juce::Colour grid{ 0xff2a2f36 };
+    const juce::Colour text{ 0xffc8ccd2 };
+    const juce::Colour dimText{ 0xff7d848d };
+    const juce::Colour accent{ 0xff3d8fd6 };
+    const juce::Colour peak{ 0xffe0a040 };
+    const juce::Colour clip{ 0xffe03a30 };
+
+    // Bands run from blue (lowest) to orange (highest).
+    inline juce::Colour band(int index, int count) {
+        auto position = static_cast<float>(index) / static_cast<float>(std::max(1, count - 1));
+        return juce::Colour::fromHSV(0.58f - 0.5f * position, 0.55f, 0.85f, 1.0f);
+    }
+}
+
+class TrioLookAndFeel : public juce::LookAndFeel_V4
+{
+public:
+
+    TrioLookAndFeel() {
+        setColour(juce::ResizableWindow::backgroundColourId, TrioColours::background);
+
+        setColour(juce::Slider::rotarySliderFillColourId, TrioColours::accent);
+        setColour(juce::Slider::rotarySliderOutlineColourId, TrioColours::grid);
+        setColour(juce::Slider::thumbColourId, TrioColours::text);
+        setColour(juce::Slider::textBoxTextColourId, TrioColours::text);
+        setColour(juce::Slider::textBoxOutlineColourId, juce::Colours::transparentBlack);
+
+        setColour(juce::ComboBox::backgroundColourId, TrioColours::background);
+        setColour(juce::ComboBox::outlineColourId, TrioColours::grid);
+        setColour(juce::ComboBox::textColourId, TrioColours::text);
+        setColour(juce::ComboBox::arrowColourId, TrioColours::dimText);
+        setColour(juce::PopupMenu::backgroundColourId, TrioColours::panel);
+        setColour(juce::PopupMenu::textColourId, TrioColours::text);
+        setColour(juce::PopupMenu::highlightedBackgroundColourId, TrioColours::accent.withAlpha(0.5f));
+
+        setColour(juce::TextButton::buttonColourId, TrioColours::background);
+        setColour(juce::TextButton::textColourOffId, TrioColours::text);
+
+        setColour(juce::ToggleButton::textColourId, TrioColours::text);
+        setColour(juce::ToggleButton::tickColourId, TrioColours::accent);
+        setColour(juce::ToggleButton::tickDisabledColourId, TrioColours::dimText);
+    }
+
+    // Flat arc knob: the track, the value arc and a pointer.
+    void drawRotarySlider(juce::Graphics& g, int x, int y, int width, int height, float sliderPos,
+                          float rotaryStartAngle, float rotaryEndAngle, juce::Slider& slider) override {
+        auto bounds = juce::Rectangle<int>(x, y, width, height).toFloat().reduced(4.0f);
+        auto lineWidth = 3.0f;
+        auto radius = std::min(bounds.getWidth(), bounds.getHeight()) * 0.5f - lineWidth * 0.5f;
+        auto centre = bounds.getCentre();
+        auto angle = rotaryStartAngle + sliderPos * (rotaryEndAngle - rotaryStartAngle);
+        auto stroke = juce::PathStrokeType(lineWidth, juce::PathStrokeType::curved, juce::PathStrokeType::rounded);
+
+        juce::Path track;
+        track.addCentredArc(centre.x, centre.y, radius, radius, 0.0f, rotaryStartAngle, rotaryEndAngle, true);
+        g.setColour(slider.findColour(juce::Slider::rotarySliderOutlineColourId));
+        g.strokePath(track, stroke);
+
+        juce::Path value;
+        value.addCentredArc(centre.x, centre.y, radius, radius, 0.0f, rotaryStartAngle, angle, true);
+        g.setColour(slider.findColour(juce::Slider::rotarySliderFillColourId));
+        g.strokePath(value, stroke);
+
+        auto tip = centre + juce::Point<float>(std::sin(angle), -std::cos(angle)) * (radius - 5.0f);
+        g.setColour(slider.findColour(juce::Slider::thumbColourId));
+        g.drawLine(centre.x, centre.y, tip.x, tip.y, 2.0f);
+    }
+};
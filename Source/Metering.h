@@ -0,0 +1,139 @@
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "Utils.h"
+#include "DSPParameters.h"
+
+#define METER_FLOOR_DB -120.0f
+#define METER_PEAK_FALL_DB_PER_SECOND 20.0f
+#define METER_RMS_MS 300.0f
+
+// Peak and RMS level in dBFS, with meter ballistics applied so a reader
+// polling at any rate sees meaningful values: the peak holds and falls at a
+// constant rate, the RMS is an exponential average over METER_RMS_MS.
+struct LevelMeter
+{
+	std::atomic<float> peakDb{ METER_FLOOR_DB };
+	std::atomic<float> rmsDb{ METER_FLOOR_DB };
+};
+
+struct BandMeter
+{
+	// Deepest gain reduction of the last block in dB, 0 or below; makeup
+	// gain is not included.
+	std::atomic<float> gainReductionDb{ 0.0f };
+	LevelMeter input;
+	LevelMeter output;
+};
+
+// Meters published by the engine once per block with relaxed stores. Any
+// thread may poll them at any time without blocking the audio thread; each
+// value is coherent on its own, but values are not a snapshot of one block.
+// The clip counters are running totals of samples above full scale, so
+// readers that want to reset them keep their own baseline.
+struct EngineMeters
+{
+	std::array<BandMeter, maxBands> bands;
+	LevelMeter input;
+	LevelMeter output;
+	std::atomic<uint32_t> inputClips{ 0 };
+	std::atomic<uint32_t> outputClips{ 0 };
+};
+
+// Per-block ballistics, shared by every follower of a block.
+struct MeterBallistics
+{
+	float peakFall{ 1.0f };
+	float rmsStep{ 1.0f };
+
+	MeterBallistics(float sampleRate, int numSamples)
+		: peakFall(dbToLinear(-METER_PEAK_FALL_DB_PER_SECOND * static_cast<float>(numSamples) / sampleRate)),
+		  rmsStep(-expm1f(-static_cast<float>(numSamples) / lengthToSamples(sampleRate, METER_RMS_MS))) {}
+};
+
+// Audio thread side of one LevelMeter: accumulates peak and sum of squares
+// over every lane group of a block, then applies the ballistics and
+// publishes. Padding lanes are silent, so they do not disturb the sums.
+class LevelFollower
+{
+	SIMDFloat peak{ 0.0f };
+	SIMDFloat sumSquares{ 0.0f };
+	SIMDFloat clips{ 0.0f };
+	uint32_t clipCount{ 0 };
+
+	float heldPeak{ 0.0f };
+	float meanSquare{ 0.0f };
+
+public:
+
+	void reset() {
+		peak = SIMDFloat(0.0f);
+		sumSquares = SIMDFloat(0.0f);
+		clips = SIMDFloat(0.0f);
+		clipCount = 0;
+		heldPeak = 0.0f;
+		meanSquare = 0.0f;
+	}
+
+	// Four independent accumulators, so the adds do not wait on each other.
+	template <bool CountClips = false>
+	void accumulate(const SIMDFloat* samples, int numSamples) {
+		SIMDFloat p[4] = { peak, SIMDFloat(0.0f), SIMDFloat(0.0f), SIMDFloat(0.0f) };
+		SIMDFloat sum[4] = { sumSquares, SIMDFloat(0.0f), SIMDFloat(0.0f), SIMDFloat(0.0f) };
+		SIMDFloat c[4] = { clips, SIMDFloat(0.0f), SIMDFloat(0.0f), SIMDFloat(0.0f) };
+		const SIMDFloat one(1.0f);
+
+		auto add = [&](int i, SIMDFloat x) {
+			auto magnitude = SIMDFloat::abs(x);
+			p[i] = SIMDFloat::max(p[i], magnitude);
+			sum[i] = sum[i] + x * x;
+			if constexpr (CountClips) c[i] = c[i] + (one & SIMDFloat::greaterThan(magnitude, one));
+		};
+
+		int s = 0;
+		for (; s + 4 <= numSamples; s += 4) {
+			for (int i = 0; i < 4; ++i) add(i, samples[s + i]);
+		}
+		for (; s < numSamples; ++s) add(0, samples[s]);
+
+		peak = SIMDFloat::max(SIMDFloat::max(p[0], p[1]), SIMDFloat::max(p[2], p[3]));
+		sumSquares = (sum[0] + sum[1]) + (sum[2] + sum[3]);
+		clips = (c[0] + c[1]) + (c[2] + c[3]);
+	}
+
+	// Also counts samples above full scale.
+	void accumulateWithClips(const SIMDFloat* samples, int numSamples) {
+		accumulate<true>(samples, numSamples);
+	}
+
+	// numValues is channels times samples of the block.
+	void publish(LevelMeter& meter, int numValues, const MeterBallistics& ballistics) {
+		auto blockPeak = 0.0f;
+		for (int l = 0; l < simdLanes; ++l) blockPeak = std::max(blockPeak, peak.get(static_cast<size_t>(l)));
+
+		heldPeak = std::max(blockPeak, heldPeak * ballistics.peakFall);
+		meanSquare += (sumSquares.sum() / static_cast<float>(std::max(1, numValues)) - meanSquare) * ballistics.rmsStep;
+
+		meter.peakDb.store(std::max(METER_FLOOR_DB, linearToDb(heldPeak)), std::memory_order_relaxed);
+		meter.rmsDb.store(std::max(METER_FLOOR_DB, linearToDb(std::sqrt(meanSquare))), std::memory_order_relaxed);
+
+		peak = SIMDFloat(0.0f);
+		sumSquares = SIMDFloat(0.0f);
+	}
+
+	void publishClips(std::atomic<uint32_t>& counter) {
+		clipCount += static_cast<uint32_t>(clips.sum());
+		clips = SIMDFloat(0.0f);
+		counter.store(clipCount, std::memory_order_relaxed);
+	}
+};
+
+#undef METER_FLOOR_DB
+#undef METER_PEAK_FALL_DB_PER_SECOND
+#undef METER_RMS_MS
@@ -2,27 +2,317 @@
 #pragma once
 
 #include <vector>
+#include <array>
+#include <algorithm>
+#include <utility>
+#include <limits>
+#include <tuple>
 using std::vector;
 
 #include "Utils.h"
+#include "FastMath.h"
 #include "DSPParameters.h"
 #include "Filters.h"
 #include "FilteredParameter.h"
+#include "Oversampling.h"
+#include "LinearPhase.h"
+#include "Metering.h"
+#include "Dispatch.h"
 
 #define DEFAULT_SR 44100.0f
 
-float msToCoefficient(float sampleRate, float length) {
-	return expf(-1.0f / lengthToSamples(sampleRate, length));
+// Largest block the engine processes at once; longer host blocks are chunked.
+// Keeps the oversampled scratch buffers small whatever the host block size.
+#define MAX_CHUNK_SIZE 512
+
+#define MAX_LOOKAHEAD_MS 10.0f
+#define MAX_RMS_WINDOW_MS 300.0f
+
+// Narrower knees are computed as this wide, so 1 / width stays finite while a
+// knee glides to 0.
+#define KNEE_MIN_WIDTH 1.0e-3f
+
+// Per sample step 1 - exp(-1 / n) of a one-pole smoother. The envelope and
+// its parameter smoothing work on the step rather than the coefficient, which
+// sits so close to 1 at high (oversampled) rates that float smoothing of it
+// stalls far from the target.
+inline float msToStep(float sampleRate, float length) {
+	return -expm1f(-1.0f / lengthToSamples(sampleRate, length));
 }
 
+// Detector link modes, in the order of the "Link Mode" choices.
+enum class LinkMode { unlinked, linked, grouped };
+
+// Detector modes, in the order of the "Detector" choices.
+enum class DetectorMode { peak, rms };
+
+// What a band runs for a block: everything, only its delays (ratio 1 and
+// unity gains), or nothing (muted or bypassed).
+enum class BandPath { full, transparent, off };
+
+// Channels that share one detector level. Each run lists where its channels
+// live in a lane-group-major level buffer, so linking a frame is a gather, a
+// max and a scatter. Runs of one channel are dropped when building.
+struct ChannelLinks
+{
+	vector<int> offsets;
+	vector<int> runStarts;
+
+	// groupOfChannel[ch] is the link group of channel ch; groupStride is the
+	// number of frames per lane group in the level buffer.
+	void build(const vector<int>& groupOfChannel, int groupStride) {
+		offsets.clear();
+		runStarts.assign(1, 0);
+
+		auto numChannels = static_cast<int>(groupOfChannel.size());
+		vector<bool> done(numChannels, false);
+
+		for (int ch = 0; ch < numChannels; ++ch) {
+			if (done[ch]) continue;
+
+			auto runStart = static_cast<int>(offsets.size());
+			for (int other = ch; other < numChannels; ++other) {
+				if (groupOfChannel[other] != groupOfChannel[ch]) continue;
+				done[other] = true;
+				offsets.push_back((other / simdLanes) * groupStride * simdLanes + other % simdLanes);
+			}
+
+			if (static_cast<int>(offsets.size()) - runStart > 1) runStarts.push_back(static_cast<int>(offsets.size()));
+			else offsets.resize(runStart);
+		}
+	}
+
+	bool empty() const {
+		return runStarts.size() < 2;
+	}
+};
+
+// Maximum of the last `window` values of each lane group (van Herk / Gil-Werman).
+// The stream is cut into segments of `window` values; a window then spans the
+// tail of the previous segment and the head of the current one, so its maximum
+// is a suffix maximum of the previous segment (computed once, when that segment
+// completes) against the running prefix maximum of the current one. That is
+// about three max operations per value whatever the window length, without
+// data-dependent branches, and every lane of a group is handled at once.
+class SlidingMaximum
+{
+	// Per group: the segment being filled and the suffix maxima of the previous
+	// one, ping-ponged in place when a segment completes.
+	vector<SIMDFloat> segments;
+	vector<int> filling;
+	vector<int> positions;
+	vector<SIMDFloat> prefixes;
+	int capacity{ 1 };
+	int window{ 1 };
+
+	SIMDFloat* segment(int group, int which) {
+		return segments.data() + (group * 2 + which) * capacity;
+	}
+
+public:
+
+	void prepare(int maxWindow, int numGroups) {
+		capacity = std::max(1, maxWindow);
+		segments.assign(static_cast<size_t>(capacity) * 2 * numGroups, SIMDFloat(0.0f));
+		filling.assign(numGroups, 0);
+		positions.assign(numGroups, 0);
+		prefixes.assign(numGroups, SIMDFloat(0.0f));
+		window = std::min(window, capacity);
+		reset();
+	}
+
+	// Until a full window has been seen, values from before the reset count as
+	// silence.
+	void reset() {
+		auto lowest = SIMDFloat(std::numeric_limits<float>::lowest());
+		std::fill(segments.begin(), segments.end(), lowest);
+		std::fill(positions.begin(), positions.end(), 0);
+		std::fill(prefixes.begin(), prefixes.end(), lowest);
+	}
+
+	// Changing the length restarts the segments.
+	void setWindow(int length) {
+		length = juce::jlimit(1, capacity, length);
+		if (length == window) return;
+		window = length;
+		reset();
+	}
+
+	// In place.
+	void process(int group, SIMDFloat* data, int numSamples) {
+		auto which = filling[group];
+		auto pos = positions[group];
+		auto prefix = prefixes[group];
+		auto* current = segment(group, which);
+		auto* previous = segment(group, 1 - which);
+
+		for (int s = 0; s < numSamples; ++s) {
+			auto x = data[s];
+			current[pos] = x;
+			prefix = pos == 0 ? x : SIMDFloat::max(prefix, x);
+
+			data[s] = pos + 1 < window ? SIMDFloat::max(previous[pos + 1], prefix) : prefix;
+
+			if (++pos == window) {
+				for (int j = window - 2; j >= 0; --j) {
+					current[j] = SIMDFloat::max(current[j], current[j + 1]);
+				}
+				std::swap(current, previous);
+				which = 1 - which;
+				pos = 0;
+			}
+		}
+
+		filling[group] = which;
+		positions[group] = pos;
+		prefixes[group] = prefix;
+	}
+};
+
+// Mean square over the last `window` base-rate samples of each lane group, at
+// O(1) per sample: a ring of squared values and a running sum that adds the
+// newest and subtracts the oldest. The sum is rebuilt from the ring once per
+// window so float rounding cannot accumulate. At an oversampling factor f each
+// slot holds the sum of f consecutive squares, which keeps the ring at the
+// base rate; the window then moves in whole base-rate steps.
+class MeanSquareWindow
+{
+	vector<SIMDFloat> rings;
+	vector<SIMDFloat> sums;
+	vector<SIMDFloat> partials;
+	vector<int> writePositions;
+	vector<int> sinceResum;
+	vector<int> filled;
+	int capacity{ 1 };
+	int window{ 1 };
+	int factor{ 1 };
+	float reciprocals[maxOversampling];
+
+	void updateReciprocals() {
+		for (int k = 0; k < factor; ++k) reciprocals[k] = 1.0f / static_cast<float>(window * factor + k);
+	}
+
+	void resum(int group) {
+		auto* ring = rings.data() + group * capacity;
+		auto mask = capacity - 1;
+		auto w = writePositions[group];
+
+		SIMDFloat sum(0.0f);
+		for (int i = 1; i <= window; ++i) sum = sum + ring[(w - i) & mask];
+		sums[group] = sum;
+		sinceResum[group] = 0;
+	}
+
+public:
+
+	void prepare(int maxWindow, int numGroups) {
+		capacity = juce::nextPowerOfTwo(maxWindow + 1);
+		rings.assign(static_cast<size_t>(capacity) * numGroups, SIMDFloat(0.0f));
+		sums.assign(numGroups, SIMDFloat(0.0f));
+		partials.assign(numGroups, SIMDFloat(0.0f));
+		writePositions.assign(numGroups, 0);
+		sinceResum.assign(numGroups, 0);
+		filled.assign(numGroups, 0);
+		window = juce::jlimit(1, capacity - 1, window);
+		updateReciprocals();
+	}
+
+	// The ring keeps capacity slots of history, so a new length takes effect
+	// at once over the values already seen.
+	void setWindow(int length) {
+		length = juce::jlimit(1, capacity - 1, length);
+		if (length == window) return;
+		window = length;
+		updateReciprocals();
+		for (int group = 0; group < static_cast<int>(sums.size()); ++group) resum(group);
+	}
+
+	void reset() {
+		for (auto* buffer : { &rings, &sums, &partials }) {
+			std::fill(buffer->begin(), buffer->end(), SIMDFloat(0.0f));
+		}
+		std::fill(sinceResum.begin(), sinceResum.end(), 0);
+		std::fill(filled.begin(), filled.end(), 0);
+	}
+
+	// Rescales the history to the new number of squares per slot.
+	void setFactor(int newFactor) {
+		if (newFactor == factor) return;
+		auto scale = SIMDFloat(static_cast<float>(newFactor) / static_cast<float>(factor));
+		for (auto& slot : rings) slot = slot * scale;
+		for (auto& sum : sums) sum = sum * scale;
+		std::fill(partials.begin(), partials.end(), SIMDFloat(0.0f));
+		std::fill(filled.begin(), filled.end(), 0);
+		factor = newFactor;
+		updateReciprocals();
+	}
+
+	// samples in, mean squares out (may alias).
+	void process(int group, const SIMDFloat* samples, SIMDFloat* meanSquares, int numSamples) {
+		auto* ring = rings.data() + group * capacity;
+		auto mask = capacity - 1;
+		auto w = writePositions[group];
+		auto count = sinceResum[group];
+		auto sum = sums[group];
+		auto partial = partials[group];
+		auto k = filled[group];
+
+		for (int s = 0; s < numSamples; ++s) {
+			auto x = samples[s];
+			partial = partial + x * x;
+
+			if (++k == factor) {
+				sum = sum + partial - ring[(w - window) & mask];
+				ring[w] = partial;
+				w = (w + 1) & mask;
+				partial = SIMDFloat(0.0f);
+				k = 0;
+
+				if (++count == window) {
+					writePositions[group] = w;
+					resum(group);
+					sum = sums[group];
+					count = 0;
+				}
+			}
+
+			meanSquares[s] = (sum + partial) * reciprocals[k];
+		}
+
+		writePositions[group] = w;
+		sinceResum[group] = count;
+		sums[group] = sum;
+		partials[group] = partial;
+		filled[group] = k;
+	}
+};
+
 class Compressor
 {
 	float sampleRate{ DEFAULT_SR };
 	float blockSize{ 0.0f };
 	int nChannels{ 1 };
 
+	// The band runs at sampleRate * oversampling; times are kept in ms so the
+	// coefficients can be rebuilt when the factor changes.
+	int oversampling{ 1 };
+	float attackMs{ 0.0f };
+	float releaseMs{ 0.0f };
+
+	// Lookahead: the detector takes the maximum level over the next
+	// lookaheadSamples, and the audio is delayed by as much to line up.
+	int lookaheadSamples{ 0 };
+	float lookaheadMs{ 0.0f };
+	SlidingMaximum levelWindow;
+	DelayLine<SIMDFloat> lookaheadDelay;
+
+	DetectorMode detector{ DetectorMode::peak };
+	float rmsWindowMs{ 10.0f };
+	MeanSquareWindow meanSquare;
+
 	FilteredParameter threshold;
 	FilteredParameter ratio;
+	FilteredParameter knee;
 	FilteredParameter attack;
 	FilteredParameter release;
 	FilteredParameter inputGain;
@@ -30,17 +320,66 @@ class Compressor
 
 	bool bypass;
 
-	float gainReduction{ 1.0f };
+	// One envelope per lane group, each lane following its own channel. Holds
+	// the depth 1 - gain and the part of the last step it could not take, see
+	// applyGain().
+	vector<SIMDFloat> gainReduction;
+	vector<SIMDFloat> gainReductionCarry;
+
+	// Lowest envelope gain since the last takeGainReduction(), for metering.
+	SIMDFloat lowestGain{ 1.0f };
+
+	// 1 / ratio - 1 for every sample of the ratio ramp, and 1 / (2 * width)
+	// for every sample of the knee ramp.
+	vector<float> slopeRamp;
+	vector<float> curvatureRamp;
+
+	// Detector levels in dB for every lane group, so channels in different
+	// groups can be linked before the gain computer runs.
+	vector<SIMDFloat> levelBuffer;
+	vector<SIMDFloat> gainBuffer;
+	vector<float> linkBuffer;
+
+	const EngineKernels* kernels{ &selectKernels(InstructionSet::baseline) };
+
+	SIMDFloat* groupLevels(int group) {
+		return levelBuffer.data() + group * static_cast<int>(blockSize);
+	}
 
 public:
 
-    void prepare(float sr, float bs, float ch) {
+	void prepare(float sr, float bs, float ch) {
 		sampleRate = sr;
 		blockSize = bs;
 		nChannels = ch;
+		oversampling = 1;
+
+		auto maxBlock = static_cast<size_t>(blockSize);
+		for (auto* parameter : { &threshold, &ratio, &knee, &attack, &release, &inputGain, &outputGain }) {
+			parameter->setMaxBlockSize(static_cast<int>(blockSize));
+		}
+		slopeRamp.assign(static_cast<size_t>(ratio.capacity()), 0.0f);
+		curvatureRamp.assign(static_cast<size_t>(knee.capacity()), 0.0f);
+
+		auto groups = static_cast<size_t>(numLaneGroups(nChannels));
+		gainReduction.assign(groups, SIMDFloat(0.0f));
+		gainReductionCarry.assign(groups, SIMDFloat(0.0f));
+		lowestGain = SIMDFloat(1.0f);
+		levelBuffer.assign(maxBlock * groups, SIMDFloat(0.0f));
+		gainBuffer.assign(maxBlock, SIMDFloat(1.0f));
+		linkBuffer.assign(maxBlock, 0.0f);
+
+		auto maxLookahead = static_cast<int>(std::ceil(lengthToSamples(sampleRate, MAX_LOOKAHEAD_MS))) * maxOversampling;
+		levelWindow.prepare(maxLookahead + 1, static_cast<int>(groups));
+		lookaheadDelay.prepare(maxLookahead, static_cast<int>(groups));
+
+		meanSquare.prepare(static_cast<int>(std::ceil(lengthToSamples(sampleRate, MAX_RMS_WINDOW_MS))), static_cast<int>(groups));
+		meanSquare.setFactor(1);
+		setRmsWindow(rmsWindowMs);
 
 		threshold.prepare(sampleRate, 0.0f);
 		ratio.prepare(sampleRate, 1.0f);
+		knee.prepare(sampleRate, 0.0f);
 		attack.prepare(sampleRate, 0.0f);
 		release.prepare(sampleRate, 0.0f);
 		inputGain.prepare(sampleRate, 1.0f);
@@ -48,155 +387,995 @@ public:
 	}
 
 	void update(float _threshold, float _ratio, float _attack, float _release, float _in, float _out) {
-		threshold.setValue(_threshold);
-		ratio.setValue(_ratio);
-		attack.setValue(msToCoefficient(sampleRate, _attack));
-		release.setValue(msToCoefficient(sampleRate, _release));
-		inputGain.setValue(dbToLinear(_in));
-		outputGain.setValue(dbToLinear(_out));
+		setThreshold(_threshold);
+		setRatio(_ratio);
+		setAttack(_attack);
+		setRelease(_release);
+		setInputGain(_in);
+		setOutputGain(_out);
 	}
 
-	float processSample(float sample) {
-		auto inputSample = sample *= inputGain.next();
-		auto sampleInDb = linearToDb(sample);
+	void setKernels(const EngineKernels& set) { kernels = &set; }
+
+	void setThreshold(float db) { threshold.setValue(db); }
+	void setRatio(float r) { ratio.setValue(r); }
+	void setKnee(float db) { knee.setValue(std::max(db, 0.0f)); }
+	void setAttack(float ms) { attackMs = ms; attack.setValue(msToStep(sampleRate * oversampling, ms)); }
+	void setRelease(float ms) { releaseMs = ms; release.setValue(msToStep(sampleRate * oversampling, ms)); }
+	void setInputGain(float db) { inputGain.setValue(dbToLinear(db)); }
+	void setOutputGain(float db) { outputGain.setValue(dbToLinear(db)); }
+
+	// Rounded to whole samples at the base rate, so the band latency stays an
+	// integer whatever the oversampling factor.
+	void setLookahead(float ms) {
+		lookaheadMs = ms;
+		auto samples = static_cast<int>(std::round(lengthToSamples(sampleRate, juce::jlimit(0.0f, MAX_LOOKAHEAD_MS, ms))));
 
-		auto currentThreshold = threshold.next();
-		auto currentRatio = ratio.next();
-		auto currentAtk = attack.next();
-		auto currentRls = release.next();
-				
-		float target{ 1.0f };
-		if (sampleInDb > currentThreshold) {
-			auto excess = sampleInDb - currentThreshold;
-			auto compressed = currentThreshold + excess / currentRatio;
-			target = dbToLinear(compressed - sampleInDb);
+		lookaheadSamples = samples;
+		levelWindow.setWindow(lookaheadSamples * oversampling + 1);
+		lookaheadDelay.setDelay(lookaheadSamples * oversampling);
+	}
+
+	// Lookahead in base rate samples.
+	int getLookaheadSamples() const { return lookaheadSamples; }
+
+	// Two envelopes that start apart close in on each other at least as fast
+	// as the slower of attack and release.
+	float getEnvelopeTimeConstantMs() const { return std::max(attackMs, releaseMs); }
+
+	float getReleaseMs() const { return releaseMs; }
+
+	// A ratio still gliding up from below 1 can leave the envelope boosting.
+	bool isReleased() const {
+		for (auto& depth : gainReduction) {
+			for (int l = 0; l < simdLanes; ++l) {
+				if (std::abs(depth.get(static_cast<size_t>(l))) > SILENCE) return false;
+			}
+		}
+		return true;
+	}
+
+	// No smoother still moving and every envelope released.
+	bool isSettled() const {
+		for (auto* parameter : { &threshold, &ratio, &knee, &attack, &release, &inputGain, &outputGain }) {
+			if (!parameter->isSettled()) return false;
+		}
+		return isReleased();
+	}
+
+	// Ratio 1 and unity gains for the whole of the next block, with every
+	// envelope released: applyGain() would only delay the signal, so
+	// passThrough() can stand in for the whole band.
+	bool isTransparent() const {
+		return ratio.isAt(1.0f) && inputGain.isAt(1.0f) && outputGain.isAt(1.0f) && isReleased();
+	}
+
+	// How far back the detector looks at the input, in ms.
+	float getDetectorMemoryMs() const {
+		return lookaheadMs + (detector == DetectorMode::rms ? rmsWindowMs : 0.0f);
+	}
+
+	// choice is the index of "Peak", "RMS".
+	void setDetector(float choice) {
+		detector = static_cast<DetectorMode>(juce::jlimit(0, 1, static_cast<int>(choice)));
+	}
+
+	void setRmsWindow(float ms) {
+		rmsWindowMs = ms;
+		auto samples = static_cast<int>(std::round(lengthToSamples(sampleRate, juce::jlimit(1.0f, MAX_RMS_WINDOW_MS, ms))));
+		meanSquare.setWindow(std::max(1, samples));
+	}
+
+	// Runs the smoothers and envelope at sampleRate * factor from now on.
+	// blockSize passed to prepare() must allow for the largest factor used.
+	void setOversampling(int factor) {
+		oversampling = factor;
+		for (auto* parameter : { &threshold, &ratio, &knee, &attack, &release, &inputGain, &outputGain }) {
+			parameter->setSampleRate(sampleRate * oversampling);
+		}
+		setAttack(attackMs);
+		setRelease(releaseMs);
+		setLookahead(lookaheadMs);
+		meanSquare.setFactor(factor);
+	}
+
+	// Forgets the levels seen so far; the detector restarts as if from silence.
+	void resetDetector() {
+		levelWindow.reset();
+		meanSquare.reset();
+	}
+
+	// Forgets the signal: detector, lookahead delay and envelopes.
+	void reset() {
+		resetDetector();
+		lookaheadDelay.reset();
+		std::fill(gainReduction.begin(), gainReduction.end(), SIMDFloat(0.0f));
+		std::fill(gainReductionCarry.begin(), gainReductionCarry.end(), SIMDFloat(0.0f));
+	}
+
+	// Advances the parameter smoothers by one block. Must be called once per
+	// block, before any lane group is processed.
+	void advance(int numSamples) {
+		for (auto* parameter : { &threshold, &attack, &release, &inputGain, &outputGain }) {
+			parameter->advance(numSamples);
 		}
 
-		if (target < gainReduction) {
-			gainReduction = currentAtk * gainReduction + (1.0f - currentAtk) * target;
+		// Settled ratios and knees leave their derived ramps as they are.
+		auto* ratios = ratio.getRamp();
+		auto changed = ratio.advance(numSamples);
+		for (int s = 0; s < changed; ++s) slopeRamp[s] = 1.0f / ratios[s] - 1.0f;
+
+		auto* widths = knee.getRamp();
+		changed = knee.advance(numSamples);
+		for (int s = 0; s < changed; ++s) curvatureRamp[s] = 0.5f / std::max(widths[s], KNEE_MIN_WIDTH);
+	}
+
+	// A band runs in three passes per block: detect() for every lane group,
+	// linkLevels() across groups, then applyGain() for every lane group.
+
+	// Applies the band input gain and stores the level in dB of key: the
+	// sample peak, or the windowed RMS. key is either samples or an external
+	// sidechain, which gets the same input gain in place. The conversion runs
+	// as a block kernel over every lane (see FastMath.h and Dispatch.h).
+	void detect(int group, SIMDFloat* samples, SIMDFloat* key, int numSamples) {
+		auto* inRamp = inputGain.getRamp();
+
+		if (!inputGain.isAt(1.0f)) {
+			kernels->scale(samples, inRamp, numSamples);
+			if (key != samples) kernels->scale(key, inRamp, numSamples);
+		}
+
+		auto* level = toFloatPointer(groupLevels(group));
+
+		if (detector == DetectorMode::rms) {
+			// 10 log10 of the mean square is half its 20 log10.
+			meanSquare.process(group, key, groupLevels(group), numSamples);
+			kernels->linearToDb(level, level, numSamples * simdLanes);
+			for (int i = 0; i < numSamples * simdLanes; ++i) level[i] *= 0.5f;
+		}
+		else {
+			kernels->linearToDb(toFloatPointer(key), level, numSamples * simdLanes);
+		}
+
+		if (lookaheadSamples > 0) levelWindow.process(group, groupLevels(group), numSamples);
+	}
+
+	// Every channel of a run follows the loudest channel of that run.
+	void linkLevels(const ChannelLinks& links, int numSamples) {
+		auto* level = toFloatPointer(levelBuffer.data());
+		auto* offsets = links.offsets.data();
+
+		auto* loudest = linkBuffer.data();
+
+		for (size_t r = 0; r + 1 < links.runStarts.size(); ++r) {
+			auto* first = offsets + links.runStarts[r];
+			auto* last = offsets + links.runStarts[r + 1];
+
+			auto* in = level + *first;
+			for (int s = 0; s < numSamples; ++s) loudest[s] = in[s * simdLanes];
+
+			for (auto* o = first + 1; o != last; ++o) {
+				in = level + *o;
+				for (int s = 0; s < numSamples; ++s) loudest[s] = std::max(loudest[s], in[s * simdLanes]);
+			}
+
+			for (auto* o = first; o != last; ++o) {
+				auto* out = level + *o;
+				for (int s = 0; s < numSamples; ++s) out[s * simdLanes] = loudest[s];
+			}
 		}
-		else if (target > gainReduction) {
-			gainReduction = currentRls * gainReduction + (1.0f - currentRls) * target;
+	}
+
+	// Static gain computer, envelope and gain for one lane group.
+	void applyGain(int group, SIMDFloat* samples, int numSamples) {
+		auto* thrRamp = threshold.getRamp();
+		auto* slope = slopeRamp.data();
+		auto* kneeRamp = knee.getRamp();
+		auto* curvature = curvatureRamp.data();
+		auto* atkRamp = attack.getRamp();
+		auto* rlsRamp = release.getRamp();
+		auto* outRamp = outputGain.getRamp();
+		auto* gainVec = gainBuffer.data();
+		auto* gain = toFloatPointer(gainVec);
+
+		// Gain in dB is (1 / ratio - 1) * excess above threshold, 0 below it.
+		// A soft knee of width w replaces the corner with the quadratic
+		// (excess + w / 2)^2 / 2w over the w dB around the threshold, which
+		// meets both straight parts with matching slope.
+		if (knee.isAt(0.0f)) kernels->hardKnee(groupLevels(group), thrRamp, slope, gainVec, numSamples);
+		else kernels->softKnee(groupLevels(group), thrRamp, slope, kneeRamp, curvature, gainVec, numSamples);
+
+		kernels->dbToLinear(gain, gain, numSamples * simdLanes);
+
+		// The envelope follows the depth 1 - gain rather than the gain, so it
+		// releases all the way to 0 instead of stalling just short of a gain
+		// of 1. Steps smaller than the float spacing at the current depth are
+		// carried over rather than lost, or a slowly moving target would leave
+		// the envelope anywhere within a dead zone of up to 0.01 dB around it,
+		// depending on the history. The target equals the envelope when
+		// neither attacking nor releasing, so picking the release step in that
+		// case leaves it unchanged.
+		const SIMDFloat one(1.0f);
+		auto depth = gainReduction[group];
+		auto carry = gainReductionCarry[group];
+		auto lowest = lowestGain;
+		for (int s = 0; s < numSamples; ++s) {
+			auto target = one - gainVec[s];
+			auto attacking = SIMDFloat::greaterThan(target, depth);
+			auto step = (SIMDFloat(atkRamp[s]) & attacking) + (SIMDFloat(rlsRamp[s]) & ~attacking);
+
+			auto change = (target - depth) * step + carry;
+			auto next = depth + change;
+			carry = change - (next - depth);
+			depth = next;
+
+			auto envelope = one - depth;
+			lowest = SIMDFloat::min(lowest, envelope);
+			gainVec[s] = envelope;
 		}
+		gainReduction[group] = depth;
+		gainReductionCarry[group] = carry;
+		lowestGain = lowest;
+
+		lookaheadDelay.process(group, samples, numSamples);
+
+		kernels->multiply(samples, gainVec, outputGain.isAt(1.0f) ? nullptr : outRamp, numSamples);
+	}
+
+	// What applyGain() does to a transparent band: the lookahead delay. The
+	// detector is not fed meanwhile, so call resetDetector() before the next
+	// detect().
+	void passThrough(int group, SIMDFloat* samples, int numSamples) {
+		lookaheadDelay.process(group, samples, numSamples);
+	}
 
-		return inputSample * gainReduction * outputGain.next();
-    }
+	// Deepest gain reduction in dB over every lane since the last call.
+	// Padding lanes are silent and never reduce.
+	float takeGainReduction() {
+		auto lowest = 1.0f;
+		for (int l = 0; l < simdLanes; ++l) lowest = std::min(lowest, lowestGain.get(static_cast<size_t>(l)));
+		lowestGain = SIMDFloat(1.0f);
+		return linearToDb(lowest);
+	}
 };
 
+// Calls f(std::integral_constant<int, I>{}) for I = 0 .. N - 1, unrolled at
+// compile time.
+template <typename F, int... I>
+inline void unrollImpl(F&& f, std::integer_sequence<int, I...>) {
+	(f(std::integral_constant<int, I>{}), ...);
+}
+
+template <int N, typename F>
+inline void unroll(F&& f) {
+	unrollImpl(std::forward<F>(f), std::make_integer_sequence<int, N>{});
+}
+
+// Crossover tree: a cascade of LR4 splits from the lowest cutoff up, so band b
+// is the low output of crossover b and the last band the high output of the
+// last crossover. Bands that skip a crossover are phase compensated with that
+// crossover's allpass while summing, which keeps the sum allpass (flat
+// magnitude) at any band count and costs one allpass per inner crossover.
+// In linear phase mode the cascade is replaced by FIR band kernels that sum to
+// a pure delay, at the cost of that delay.
+template <int NumBands>
 class MultibandCompressor
 {
-	Compressor lowBand;
-	Compressor midBand;
-	Compressor highBand;
+	static_assert(NumBands >= 2 && NumBands <= maxBands, "MultibandCompressor supports 2 to 8 bands");
+	static constexpr int numCrossovers = NumBands - 1;
+
+	std::array<Compressor, NumBands> bands;
 
-	LRFilter<float> lowMidFilter;
-	LRFilter<float> midHighFilter;
-	FilteredParameter lowMidCut;
-	FilteredParameter midHighCut;
+	std::array<LRFilter<SIMDFloat>, numCrossovers> crossovers;
+	std::array<FilteredParameter, numCrossovers> cutoffs;
+	LinearPhaseCrossover<NumBands> linearPhase;
+	CrossoverMode crossoverMode{ CrossoverMode::iir };
+	CrossoverMode selectedCrossoverMode{ CrossoverMode::iir };
 
 	float sampleRate{ DEFAULT_SR };
 	float blockSize { 0.0f };
 	int   nChannels { 1 };
+	int   nGroups { 1 };
 
-	SmoothLogParameter lowEnabled;
-	SmoothLogParameter midEnabled;
-	SmoothLogParameter highEnabled;
+	std::array<SmoothLogParameter, NumBands> bandEnabled;
 	SmoothLogParameter allEnabled;
 
+	// Chosen per block once the fades have finished, see choosePaths().
+	std::array<BandPath, NumBands> bandPaths{};
+	bool bypassed{ false };
+
 	FilteredParameter inputGain;
 	FilteredParameter outputGain;
 
-	float inputLow{ 1.0f };
+	LinkMode linkMode{ LinkMode::unlinked };
+	vector<int> channelGroups;
+	ChannelLinks groupedLinks;
+	ChannelLinks allLinks;
 
-public:
+	// Per-band oversampling and lookahead both delay a band. Bands with less
+	// latency than the slowest one, and the dry signal, are delayed to match.
+	std::array<Oversampler<SIMDFloat>, NumBands> oversamplers;
+	std::array<int, NumBands> oversampling{};
+	std::array<DelayLine<SIMDFloat>, NumBands> bandDelays;
+	DelayLine<SIMDFloat> dryDelay;
+	int latency{ 0 };
+
+	// External sidechain, while one is passed to processBlock(). It gets the
+	// engine input gain, the crossover latency and the IIR split through the
+	// program crossovers, then each band's oversampling, so every detector
+	// sees its band of the key where it would have seen its band of the
+	// program. The crossovers and oversamplers hold it as extra lane groups
+	// nGroups to 2 * nGroups - 1, so it shares their coefficients.
+	bool keyed{ false };
+	std::tuple<vector<const float*>, vector<const double*>> sidechainChannels;
+	vector<SIMDFloat> sidechainBuffer;
+	std::array<vector<SIMDFloat>, NumBands> sidechainBands;
+	vector<SIMDFloat> oversampledSidechain;
+	DelayLine<SIMDFloat> sidechainDelay;
+
+	// Once the input has been silent for tailSamples and nothing is left
+	// moving, blocks of silence are passed through without processing.
+	int tailSamples{ 0 };
+	int silentSamples{ 0 };
+
+	// Levels are accumulated while the block runs and published at its end.
+	EngineMeters meters;
+	LevelFollower inputLevel;
+	LevelFollower outputLevel;
+	std::array<LevelFollower, NumBands> bandInputLevels;
+	std::array<LevelFollower, NumBands> bandOutputLevels;
+
+	// Per-block scratch: one buffer per band plus the dry signal, each holding
+	// every lane group back to back.
+	vector<SIMDFloat> dryBuffer;
+	std::array<vector<SIMDFloat>, NumBands> bandBuffers;
+	vector<SIMDFloat> oversampledBuffer;
+
+	// Chosen in prepare(), see Dispatch.h.
+	InstructionSet requestedInstructionSet{ InstructionSet::automatic };
+	const EngineKernels* kernels{ &selectKernels(InstructionSet::baseline) };
+
+	SIMDFloat* groupSlice(vector<SIMDFloat>& buffer, int group) {
+		return buffer.data() + group * static_cast<int>(blockSize);
+	}
+
+	SIMDFloat* oversampledSlice(int group) {
+		return oversampledBuffer.data() + group * static_cast<int>(blockSize) * maxOversampling;
+	}
+
+	SIMDFloat* oversampledSidechainSlice(int group) {
+		return oversampledSidechain.data() + group * static_cast<int>(blockSize) * maxOversampling;
+	}
+
+	// Advances every smoother by one block; the ramps of settled ones are
+	// left as they are.
+	void fillRamps(int numSamples) {
+		inputGain.advance(numSamples);
+		allEnabled.advance(numSamples);
+		outputGain.advance(numSamples);
+
+		for (auto& enabled : bandEnabled) enabled.advance(numSamples);
+		for (auto& cutoff : cutoffs) cutoff.advance(numSamples);
+
+		for (int b = 0; b < NumBands; ++b) bands[b].advance(numSamples * oversampling[b]);
+
+		for (int i = 0; i < numCrossovers; ++i) {
+			crossovers[i].updateCoefficients(cutoffs[i].getRamp(), numSamples);
+		}
+	}
 
-	void prepare(DSPParameters<float>& params) {
-		sampleRate = params["sampleRate"];
-		blockSize = params["blockSize"];
-		nChannels = static_cast<int>(params["nChannels"]);
-		
-		lowEnabled. prepare(sampleRate, 1.0f - params["muteLow"]);
-		midEnabled. prepare(sampleRate, 1.0f - params["muteMid"]);
-		highEnabled.prepare(sampleRate, 1.0f - params["muteHigh"]);
-		allEnabled. prepare(sampleRate, 1.0f - params["bypass"]);
-
-		lowBand.prepare(sampleRate, blockSize, nChannels);
-		lowBand.update(params["thresholdLow"], params["ratioLow"], 
-					   params["attackLow"], params["releaseLow"],
-					   params["inputLow"], params["outputLow"]);
-		
-		midBand.prepare(sampleRate, blockSize, nChannels);
-		midBand.update(params["thresholdMid"], params["ratioMid"], 
-					   params["attackMid"], params["releaseMid"], 
-					   params["inputMid"], params["outputMid"]);
-		
-		highBand.prepare(sampleRate, blockSize, nChannels);
-		highBand.update(params["thresholdHigh"], params["ratioHigh"], 
-						params["attackHigh"], params["releaseHigh"],
-					    params["inputHigh"], params["outputHigh"]);
-
-		lowMidFilter.prepare(sampleRate, blockSize, nChannels);
-		lowMidCut.prepare(sampleRate, params["lowMidCut"]);
-		
-		midHighFilter.prepare(sampleRate, blockSize, nChannels);
-		midHighCut.prepare(sampleRate, params["midHighCut"]);
-
-		inputGain.prepare(sampleRate, dbToLinear(params["inputAll"]));
-		outputGain.prepare(sampleRate, dbToLinear(params["outputGainAll"]));
-
-	}
-
-	void update(DSPParameters<float>& params) {
-		lowEnabled.setValue(1.0f - params["muteLow"]);
-		midEnabled.setValue(1.0f - params["muteMid"]);
-		highEnabled.setValue(1.0f - params["muteHigh"]);
-		allEnabled.setValue(1.0f - params["bypass"]);
-
-		lowMidCut.setValue(params["lowMidCut"]);
-		midHighCut.setValue(params["midHighCut"]);
-
-		lowBand.update(params["thresholdLow"], params["ratioLow"],
-			params["attackLow"], params["releaseLow"],
-			params["inputLow"], params["outputLow"]);
-
-		midBand.update(params["thresholdMid"], params["ratioMid"],
-			params["attackMid"], params["releaseMid"],
-			params["inputMid"], params["outputMid"]);
-
-		highBand.update(params["thresholdHigh"], params["ratioHigh"],
-			params["attackHigh"], params["releaseHigh"],
-			params["inputHigh"], params["outputHigh"]);
-
-		inputGain.setValue(dbToLinear(params["inputAll"]));
-		outputGain.setValue(dbToLinear(params["outputAll"]));
-	
-	}
-
-	void processBlock(float** inputBuffer, int numChannels, int numSamples) {
+	// A band that has faded out, or the whole engine once bypassed, stops
+	// running and is cleared, so it resumes from silence while its fade in
+	// still holds it below -80 dB. A transparent band keeps its delays
+	// running; only the detector it stops feeding is cleared when it resumes.
+	void choosePaths() {
+		auto wasBypassed = bypassed;
+		bypassed = allEnabled.isOff();
+
+		if (bypassed && !wasBypassed) {
+			linearPhase.reset();
+			for (auto& crossover : crossovers) crossover.reset();
+		}
+
+		for (int b = 0; b < NumBands; ++b) {
+			auto path = BandPath::full;
+			if (bypassed || bandEnabled[b].isOff()) path = BandPath::off;
+			else if (bands[b].isTransparent()) path = BandPath::transparent;
+
+			if (path == bandPaths[b]) continue;
+
+			if (path == BandPath::off) {
+				bands[b].reset();
+				oversamplers[b].reset();
+				bandDelays[b].reset();
+			}
+			else if (bandPaths[b] == BandPath::transparent) {
+				bands[b].resetDetector();
+			}
+			bandPaths[b] = path;
+		}
+	}
+
+	static void updateBand(Compressor& band, int b, const DSPParameters<float>& params, bool force) {
+		if (force || params.isDirty(THRESHOLD + b))   band.setThreshold(params[THRESHOLD + b]);
+		if (force || params.isDirty(RATIO + b))       band.setRatio(params[RATIO + b]);
+		if (force || params.isDirty(KNEE + b))        band.setKnee(params[KNEE + b]);
+		if (force || params.isDirty(ATTACK + b))      band.setAttack(params[ATTACK + b]);
+		if (force || params.isDirty(RELEASE + b))     band.setRelease(params[RELEASE + b]);
+		if (force || params.isDirty(BAND_INPUT + b))  band.setInputGain(params[BAND_INPUT + b]);
+		if (force || params.isDirty(BAND_OUTPUT + b)) band.setOutputGain(params[BAND_OUTPUT + b]);
+	}
+
+	// choice is the index of "Off", "2x", "4x", "8x".
+	void setOversampling(int b, float choice) {
+		auto factor = 1 << juce::jlimit(0, maxOversamplingStages, static_cast<int>(choice));
+		if (factor == oversampling[b]) return;
+
+		oversampling[b] = factor;
+		oversamplers[b].setFactor(factor);
+		bands[b].setOversampling(factor);
+		updateLatency();
+	}
+
+	int bandLatency(int b) const {
+		return oversamplers[b].getLatency() + bands[b].getLookaheadSamples();
+	}
+
+	int crossoverLatency() const {
+		return crossoverMode == CrossoverMode::linearPhase ? linearPhase.getLatency() : 0;
+	}
+
+	void updateLatency() {
+		latency = 0;
+		for (int b = 0; b < NumBands; ++b) latency = std::max(latency, bandLatency(b));
+
+		for (int b = 0; b < NumBands; ++b) bandDelays[b].setDelay(latency - bandLatency(b));
+		dryDelay.setDelay(crossoverLatency() + latency);
+		sidechainDelay.setDelay(crossoverLatency());
+	}
+
+	// Linear phase is set up on the message thread the first time it is
+	// selected; the IIR split runs on until it is ready.
+	void setCrossoverMode(float mode) {
+		selectedCrossoverMode = static_cast<CrossoverMode>(juce::jlimit(0, 1, static_cast<int>(mode)));
+		if (selectedCrossoverMode == CrossoverMode::linearPhase && !linearPhase.isEnabled()) linearPhase.requestEnable();
+		applyCrossoverMode();
+	}
+
+	// The split that sat idle holds stale state, and the dry delay jumps. The
+	// linear phase kernels missed the cutoff changes made meanwhile, so they
+	// are redesigned and faded in.
+	void applyCrossoverMode() {
+		auto next = selectedCrossoverMode;
+		if (next == CrossoverMode::linearPhase && !linearPhase.isEnabled()) return;
+		if (next == crossoverMode) return;
+
+		crossoverMode = next;
+		if (crossoverMode == CrossoverMode::linearPhase) {
+			linearPhase.reset();
+			linearPhase.redesign();
+		}
+		else for (auto& crossover : crossovers) crossover.reset();
+		dryDelay.reset();
+		sidechainDelay.reset();
+		updateLatency();
+		updateTail();
+	}
+
+	void setLinkMode(float mode) {
+		linkMode = static_cast<LinkMode>(juce::jlimit(0, 2, static_cast<int>(mode)));
+	}
+
+	// Channels with no explicit group are paired up (0-1, 2-3, ...).
+	void buildLinks() {
+		vector<int> groups(channelGroups);
+		for (int ch = static_cast<int>(groups.size()); ch < nChannels; ++ch) {
+			groups.push_back(-1 - ch / 2);
+		}
+		groups.resize(nChannels);
+
+		// Level buffers are laid out for the oversampled block size.
+		auto stride = static_cast<int>(blockSize) * maxOversampling;
+		groupedLinks.build(groups, stride);
+		allLinks.build(vector<int>(nChannels, 0), stride);
+	}
+
+	const ChannelLinks* activeLinks() const {
+		switch (linkMode) {
+			case LinkMode::linked:   return allLinks.empty() ? nullptr : &allLinks;
+			case LinkMode::grouped:  return groupedLinks.empty() ? nullptr : &groupedLinks;
+			case LinkMode::unlinked: break;
+		}
+		return nullptr;
+	}
+
+	// In the IIR cascade each split reads the previous high output from the
+	// next band's buffer and overwrites it with its own low output; each split
+	// runs over every lane group at once, so wide kernels can take several.
+	// The linear phase split also runs over every lane group at once, since
+	// it works in partitions that need not line up with the block.
+	void splitBands(int groups, int numSamples) {
+		auto* inRamp = inputGain.getRamp();
+		auto stride = static_cast<int>(blockSize);
+
+		if (!inputGain.isAt(1.0f)) {
+			for (int group = 0; group < groups; ++group) kernels->scale(groupSlice(dryBuffer, group), inRamp, numSamples);
+		}
+
+		if (crossoverMode == CrossoverMode::iir) {
+			const SIMDFloat* input = dryBuffer.data();
+			unroll<numCrossovers>([&](auto i) {
+				kernels->split(crossovers[i], 0, groups, stride, input, bandBuffers[i].data(), bandBuffers[i + 1].data(), numSamples);
+				input = bandBuffers[i + 1].data();
+			});
+		}
+		else {
+			SIMDFloat* outputs[NumBands];
+			for (int b = 0; b < NumBands; ++b) outputs[b] = bandBuffers[b].data();
+			linearPhase.process(dryBuffer.data(), outputs, static_cast<int>(blockSize), groups, numSamples);
+		}
+
+		for (int group = 0; group < groups; ++group) {
+			dryDelay.process(group, groupSlice(dryBuffer, group), numSamples);
+		}
+	}
+
+	// The key takes the path of the program up to the band split, IIR even in
+	// linear phase mode: the detectors need its level, not its phase, and the
+	// crossover latency is matched with a delay instead.
+	void splitSidechain(int groups, int numSamples) {
+		auto* inRamp = inputGain.getRamp();
+		auto unity = inputGain.isAt(1.0f);
+		auto stride = static_cast<int>(blockSize);
+
+		for (int group = 0; group < groups; ++group) {
+			auto* key = groupSlice(sidechainBuffer, group);
+			if (!unity) kernels->scale(key, inRamp, numSamples);
+			sidechainDelay.process(group, key, numSamples);
+		}
+
+		const SIMDFloat* input = sidechainBuffer.data();
+		unroll<numCrossovers>([&](auto i) {
+			kernels->split(crossovers[i], nGroups, groups, stride, input, sidechainBands[i].data(), sidechainBands[i + 1].data(), numSamples);
+			input = sidechainBands[i + 1].data();
+		});
+	}
+
+	// Oversampled bands run detection and gain on the upsampled signal, all
+	// groups at once so they can still be linked, then decimate back.
+	void processBand(int b, const ChannelLinks* links, int groups, int numSamples) {
+		auto& band = bands[b];
+		auto factor = oversampling[b];
+		auto n = numSamples * factor;
+
+		auto samples = [&](int group) {
+			return factor > 1 ? oversampledSlice(group) : groupSlice(bandBuffers[b], group);
+		};
+
+		auto key = [&](int group) {
+			if (!keyed) return samples(group);
+			return factor > 1 ? oversampledSidechainSlice(group) : groupSlice(sidechainBands[b], group);
+		};
+
+		auto transparent = bandPaths[b] == BandPath::transparent;
+
+		for (int group = 0; group < groups; ++group) {
+			bandInputLevels[b].accumulate(groupSlice(bandBuffers[b], group), numSamples);
+			if (factor > 1) oversamplers[b].upsample(group, groupSlice(bandBuffers[b], group), oversampledSlice(group), numSamples);
+			if (transparent) continue;
+
+			if (keyed && factor > 1) {
+				oversamplers[b].upsample(nGroups + group, groupSlice(sidechainBands[b], group), oversampledSidechainSlice(group), numSamples);
+			}
+			band.detect(group, samples(group), key(group), n);
+		}
+
+		if (links != nullptr && !transparent) band.linkLevels(*links, n);
+
+		for (int group = 0; group < groups; ++group) {
+			if (transparent) band.passThrough(group, samples(group), n);
+			else band.applyGain(group, samples(group), n);
+			if (factor > 1) oversamplers[b].downsample(group, oversampledSlice(group), groupSlice(bandBuffers[b], group), numSamples);
+			bandDelays[b].process(group, groupSlice(bandBuffers[b], group), numSamples);
+			bandOutputLevels[b].accumulate(groupSlice(bandBuffers[b], group), numSamples);
+		}
+	}
+
+	// Slowest decay of the IIR crossovers in ms: the poles of an LR4 section
+	// decay at 2 pi f / sqrt(2).
+	float crossoverTimeConstantMs() const {
+		if (crossoverMode != CrossoverMode::iir) return 0.0f;
+
+		auto slowestMs = 0.0f;
+		for (auto& cutoff : cutoffs) {
+			slowestMs = std::max(slowestMs, 1000.0f * juce::MathConstants<float>::sqrt2 / (juce::MathConstants<float>::twoPi * cutoff.read()));
+		}
+		return slowestMs;
+	}
+
+	// Samples the FIR filters, detector windows and delays remember.
+	float memorySamples() const {
+		auto memoryMs = 0.0f;
+		for (auto& band : bands) memoryMs = std::max(memoryMs, band.getDetectorMemoryMs());
+		return lengthToSamples(sampleRate, memoryMs) + 2.0f * static_cast<float>(getLatencySamples());
+	}
+
+	// Silence in comes out as silence, with every envelope released, after
+	// the crossovers and releases decay to SILENCE and the memories flush.
+	void updateTail() {
+		auto slowestMs = crossoverTimeConstantMs();
+		for (auto& band : bands) slowestMs = std::max(slowestMs, band.getReleaseMs());
+
+		auto recursive = lengthToSamples(sampleRate, slowestMs * std::log(1.0f / SILENCE));
+		tailSamples = static_cast<int>(std::ceil(recursive + memorySamples()));
+	}
+
+	bool isSettled() const {
+		for (auto& band : bands) {
+			if (!band.isSettled()) return false;
+		}
+		for (auto& cutoff : cutoffs) {
+			if (!cutoff.isSettled()) return false;
+		}
+		for (auto& enabled : bandEnabled) {
+			if (!enabled.isSettled()) return false;
+		}
+		return allEnabled.isSettled() && inputGain.isSettled() && outputGain.isSettled();
+	}
+
+	template <typename SampleType>
+	static bool isSilent(const SampleType* const* channels, int numChannels, int numSamples) {
 		for (int ch = 0; ch < numChannels; ++ch) {
-			for (int s = 0; s < numSamples; ++s) {
-				auto sample = inputGain.next() * inputBuffer[ch][s];
+			auto peak = SampleType(0);
+			for (int s = 0; s < numSamples; ++s) peak = std::max(peak, std::abs(channels[ch][s]));
+			if (peak > SILENCE) return false;
+		}
+		return true;
+	}
+
+	void publishMeters(int numChannels, int numSamples) {
+		MeterBallistics ballistics(sampleRate, numSamples);
+		auto numValues = numChannels * numSamples;
 
-				float lowBandFiltered, midBandFiltered, highBandFiltered;
-				float lowBandCompressed, midBandCompressed, highBandCompressed;
+		for (int b = 0; b < NumBands; ++b) {
+			auto& meter = meters.bands[b];
+			meter.gainReductionDb.store(bands[b].takeGainReduction(), std::memory_order_relaxed);
+			bandInputLevels[b].publish(meter.input, numValues, ballistics);
+			bandOutputLevels[b].publish(meter.output, numValues, ballistics);
+		}
 
-				lowMidFilter.setFrequency(lowMidCut.next());
-				midHighFilter.setFrequency(midHighCut.next());
+		inputLevel.publish(meters.input, numValues, ballistics);
+		outputLevel.publish(meters.output, numValues, ballistics);
+		inputLevel.publishClips(meters.inputClips);
+		outputLevel.publishClips(meters.outputClips);
+	}
 
-				lowMidFilter.processSample(ch, sample, lowBandFiltered, midBandFiltered);
-				midHighFilter.processSample(ch, midBandFiltered, midBandFiltered, highBandFiltered);
+	// Sums the bands from the lowest up, running the partial sum through the
+	// allpass of crossover b before band b is added (linear phase bands need
+	// no compensation), then writes the mix back into the dry buffer. Bands
+	// that are off add nothing, but the compensation still runs.
+	void sumBands(int groups, int numSamples) {
+		auto stride = static_cast<int>(blockSize);
+		auto* firstOn = bandEnabled[0].getRamp();
 
-				lowBandCompressed = lowBand.processSample(lowBandFiltered) * lowEnabled.next();
-				midBandCompressed = midBand.processSample(midBandFiltered) * midEnabled.next();
-				highBandCompressed = highBand.processSample(highBandFiltered) * highEnabled.next();
+		for (int group = 0; group < groups; ++group) {
+			auto* sum = groupSlice(bandBuffers[0], group);
+			if (bandPaths[0] == BandPath::off) std::fill(sum, sum + numSamples, SIMDFloat(0.0f));
+			else kernels->scale(sum, firstOn, numSamples);
+		}
+
+		unroll<NumBands - 1>([&](auto i) {
+			constexpr int b = decltype(i)::value + 1;
+			if constexpr (b < numCrossovers) {
+				if (crossoverMode == CrossoverMode::iir) kernels->allpass(crossovers[b], 0, groups, stride, bandBuffers[0].data(), numSamples);
+			}
 
-				auto amplitude = allEnabled.next();
+			if (bandPaths[b] == BandPath::off) return;
 
-				inputBuffer[ch][s] = sample * (1.0f - amplitude) + 
-					((lowBandCompressed + midBandCompressed + highBandCompressed) * outputGain.next() * amplitude);
+			auto* on = bandEnabled[b].getRamp();
+			for (int group = 0; group < groups; ++group) {
+				kernels->accumulate(groupSlice(bandBuffers[0], group), groupSlice(bandBuffers[b], group), on, numSamples);
 			}
+		});
+
+		auto* wet = allEnabled.getRamp();
+		auto* outRamp = outputGain.getRamp();
+
+		for (int group = 0; group < groups; ++group) {
+			kernels->mix(groupSlice(dryBuffer, group), groupSlice(bandBuffers[0], group), wet, outRamp, numSamples);
+		}
+	}
+
+	// What splitBands() and sumBands() do to the dry signal, for a bypassed
+	// engine whose wet share has faded out.
+	void passDry(int group, int numSamples) {
+		auto* dry = groupSlice(dryBuffer, group);
+		auto* inRamp = inputGain.getRamp();
+		auto* wet = allEnabled.getRamp();
+
+		if (!inputGain.isAt(1.0f)) kernels->scale(dry, inRamp, numSamples);
+
+		dryDelay.process(group, dry, numSamples);
+
+		for (int s = 0; s < numSamples; ++s) {
+			dry[s] = dry[s] * (1.0f - wet[s]);
+		}
+	}
+
+public:
+
+	static constexpr int getNumBands() { return NumBands; }
+
+	// Delay added by the linear phase crossover, oversampling and lookahead,
+	// in samples; changes with the crossover mode and the per-band settings.
+	int getLatencySamples() const { return crossoverLatency() + latency; }
+
+	// Samples of input after prepare() before the output matches, to within
+	// toleranceDb of full scale, an engine that had been running all along on
+	// the same signal with the same parameters. The recursive state has to
+	// decay by toleranceDb: first the parameter smoothers, which start from 0,
+	// then the envelopes and IIR crossovers that depend on them. The finite
+	// memories (FIR filters, detector windows, delays) have to refill.
+	int getSettlingSamples(float toleranceDb) const {
+		auto timeConstants = std::log(1.0f / dbToLinear(-std::abs(toleranceDb)));
+
+		auto slowestMs = crossoverTimeConstantMs();
+		for (auto& band : bands) slowestMs = std::max(slowestMs, band.getEnvelopeTimeConstantMs());
+
+		auto recursiveMs = (1000.0f * FilteredParameter::timeConstant() + slowestMs) * timeConstants;
+		return static_cast<int>(std::ceil(lengthToSamples(sampleRate, recursiveMs) + memorySamples()));
+	}
+
+	// Samples after the input falls silent until the output has decayed to
+	// silence and every envelope has released: the tail to report to hosts.
+	int getTailSamples() const { return tailSamples; }
+
+	// Safe to poll from any thread; see EngineMeters.
+	const EngineMeters& getMeters() const { return meters; }
+
+	// Kernels to use from the next prepare() on: automatic picks the widest
+	// set the CPU has, or the one TRIO_ISA names. A set the CPU lacks falls
+	// back to the widest one below it.
+	void setInstructionSet(InstructionSet set) {
+		requestedInstructionSet = set;
+	}
+
+	// The set prepare() chose.
+	InstructionSet getInstructionSet() const {
+		return kernels->instructionSet;
+	}
+
+	void prepare(float sr, int maxBlockSize, int numChannels, const DSPParameters<float>& params) {
+		kernels = &selectKernels(requestedInstructionSet);
+		sampleRate = sr;
+		blockSize = static_cast<float>(std::min(maxBlockSize, MAX_CHUNK_SIZE));
+		nChannels = numChannels;
+		nGroups = numLaneGroups(nChannels);
+
+		auto bufferSize = static_cast<size_t>(blockSize) * static_cast<size_t>(nGroups);
+		dryBuffer.assign(bufferSize, SIMDFloat(0.0f));
+		for (auto& buffer : bandBuffers) {
+			buffer.assign(bufferSize, SIMDFloat(0.0f));
+		}
+		oversampledBuffer.assign(bufferSize * maxOversampling, SIMDFloat(0.0f));
+
+		std::get<0>(sidechainChannels).assign(static_cast<size_t>(nChannels), nullptr);
+		std::get<1>(sidechainChannels).assign(static_cast<size_t>(nChannels), nullptr);
+		sidechainBuffer.assign(bufferSize, SIMDFloat(0.0f));
+		for (auto& buffer : sidechainBands) {
+			buffer.assign(bufferSize, SIMDFloat(0.0f));
+		}
+		oversampledSidechain.assign(bufferSize * maxOversampling, SIMDFloat(0.0f));
+		keyed = false;
+
+		auto maxBlock = static_cast<int>(blockSize);
+		inputGain.setMaxBlockSize(maxBlock);
+		outputGain.setMaxBlockSize(maxBlock);
+		allEnabled.setMaxBlockSize(maxBlock);
+		for (auto& enabled : bandEnabled) enabled.setMaxBlockSize(maxBlock);
+		for (auto& cutoff : cutoffs) cutoff.setMaxBlockSize(maxBlock);
+
+		float targets[numCrossovers];
+		for (int i = 0; i < numCrossovers; ++i) targets[i] = params[CROSSOVER + i];
+		selectedCrossoverMode = static_cast<CrossoverMode>(juce::jlimit(0, 1, static_cast<int>(params[CROSSOVER_MODE])));
+		crossoverMode = selectedCrossoverMode;
+		linearPhase.prepare(sampleRate, nChannels, targets, crossoverMode == CrossoverMode::linearPhase);
+
+		auto maxLatency = oversamplers[0].getMaxLatency()
+						+ static_cast<int>(std::ceil(lengthToSamples(sampleRate, MAX_LOOKAHEAD_MS)));
+		dryDelay.prepare(linearPhase.getLatency() + maxLatency, nGroups);
+		sidechainDelay.prepare(linearPhase.getLatency(), nGroups);
+
+		for (int b = 0; b < NumBands; ++b) {
+			bandEnabled[b].prepare(sampleRate, 1.0f - params[MUTE + b]);
+
+			bands[b].prepare(sampleRate, blockSize * maxOversampling, nChannels);
+			bands[b].setKernels(*kernels);
+			oversamplers[b].prepare(static_cast<int>(blockSize), 2 * nGroups);
+			bandDelays[b].prepare(maxLatency, nGroups);
+
+			oversampling[b] = 0;
+			setOversampling(b, params[OVERSAMPLING + b]);
+			updateBand(bands[b], b, params, true);
+			bands[b].setLookahead(params[LOOKAHEAD + b]);
+			bands[b].setDetector(params[DETECTOR + b]);
+			bands[b].setRmsWindow(params[RMS_WINDOW + b]);
+		}
+		updateLatency();
+		allEnabled.prepare(sampleRate, 1.0f - params[BYPASS]);
+
+		for (int i = 0; i < numCrossovers; ++i) {
+			crossovers[i].prepare(sampleRate, blockSize, 2 * nGroups);
+			cutoffs[i].prepare(sampleRate, params[CROSSOVER + i]);
+		}
+
+		inputGain.prepare(sampleRate, dbToLinear(params[INPUT_ALL]));
+		outputGain.prepare(sampleRate, dbToLinear(params[OUTPUT_ALL]));
+
+		setLinkMode(params[LINK_MODE]);
+		buildLinks();
+
+		inputLevel.reset();
+		outputLevel.reset();
+		for (auto& level : bandInputLevels)  level.reset();
+		for (auto& level : bandOutputLevels) level.reset();
+
+		updateTail();
+		silentSamples = 0;
+		bandPaths.fill(BandPath::full);
+		bypassed = false;
+	}
+
+	// Stops the linear phase worker until the next prepare().
+	void release() {
+		linearPhase.release();
+	}
+
+	// Link groups used by LinkMode::grouped: channels with the same value share
+	// a detector. Call before prepare(); channels past the end are paired up.
+	void setChannelGroups(const vector<int>& groupOfChannel) {
+		channelGroups = groupOfChannel;
+	}
+
+	// Number of samples between crossover coefficient updates.
+	void setCrossoverControlInterval(int samples) {
+		for (auto& crossover : crossovers) crossover.setControlInterval(samples);
+	}
+
+	// Applies the entries marked dirty in params; everything else is untouched.
+	void update(const DSPParameters<float>& params) {
+		for (int b = 0; b < NumBands; ++b) {
+			if (params.isDirty(MUTE + b)) bandEnabled[b].setValue(1.0f - params[MUTE + b]);
+			updateBand(bands[b], b, params, false);
+			if (params.isDirty(OVERSAMPLING + b)) setOversampling(b, params[OVERSAMPLING + b]);
+			if (params.isDirty(DETECTOR + b))   bands[b].setDetector(params[DETECTOR + b]);
+			if (params.isDirty(RMS_WINDOW + b)) bands[b].setRmsWindow(params[RMS_WINDOW + b]);
+			if (params.isDirty(LOOKAHEAD + b)) {
+				bands[b].setLookahead(params[LOOKAHEAD + b]);
+				updateLatency();
+			}
+		}
+		if (params.isDirty(BYPASS)) allEnabled.setValue(1.0f - params[BYPASS]);
+
+		auto cutoffChanged = false;
+		for (int i = 0; i < numCrossovers; ++i) {
+			if (params.isDirty(CROSSOVER + i)) {
+				cutoffs[i].setValue(params[CROSSOVER + i]);
+				linearPhase.setCutoff(i, params[CROSSOVER + i]);
+				cutoffChanged = true;
+			}
+		}
+		if (cutoffChanged && crossoverMode == CrossoverMode::linearPhase) linearPhase.redesign();
+		if (params.isDirty(CROSSOVER_MODE)) setCrossoverMode(params[CROSSOVER_MODE]);
+
+		if (params.isDirty(INPUT_ALL))  inputGain.setValue(dbToLinear(params[INPUT_ALL]));
+		if (params.isDirty(OUTPUT_ALL)) outputGain.setValue(dbToLinear(params[OUTPUT_ALL]));
+
+		if (params.isDirty(LINK_MODE)) setLinkMode(params[LINK_MODE]);
+
+		updateTail();
+	}
+
+	// Band-major processing over lane groups: channels are packed into SIMD
+	// lanes (four or eight channels share one register) and each stage runs
+	// over the whole block before the next one starts. Every lane group is
+	// split first so the detectors can be linked across groups. Blocks larger
+	// than the prepared size are processed in chunks. Muted and transparent
+	// bands, and a bypassed engine, skip the work that would not change the
+	// output; see choosePaths().
+	// A silent block that follows a whole tail of silence, with nothing left
+	// to settle, is written as silence without running anything; the state
+	// it leaves is what processing would have left, give or take SILENCE, so
+	// the next signal picks up seamlessly.
+	// SampleType is float or double. The engine runs in float either way;
+	// double channels are converted as they are packed into lanes.
+	template <typename SampleType>
+	void processBlock(SampleType* const* channels, int numChannels, int numSamples) {
+		processBlock<SampleType>(channels, numChannels, nullptr, 0, numSamples);
+	}
+
+	// Keys the detectors from sidechain instead of the program: channel ch
+	// from sidechain channel ch modulo numSidechainChannels, so a mono key
+	// drives every channel. No sidechain (nullptr or no channels) costs
+	// nothing over the overload above.
+	template <typename SampleType>
+	void processBlock(SampleType* const* channels, int numChannels,
+					  const SampleType* const* sidechain, int numSidechainChannels, int numSamples) {
+		auto maxBlock = static_cast<int>(blockSize);
+		jassert(maxBlock > 0);
+		if (maxBlock <= 0) return;
+
+		numChannels = std::min(numChannels, nChannels);
+		auto groups = numLaneGroups(numChannels);
+
+		// A key that comes back after a break would find its own stale delay
+		// and filter state; the key uses lane groups nGroups and up.
+		auto wasKeyed = keyed;
+		keyed = sidechain != nullptr && numSidechainChannels > 0;
+		if (keyed && !wasKeyed) {
+			sidechainDelay.reset();
+			for (auto& crossover : crossovers) crossover.reset(nGroups, nGroups);
+			for (auto& oversampler : oversamplers) oversampler.reset(nGroups, nGroups);
+		}
+
+		if (crossoverMode != selectedCrossoverMode) applyCrossoverMode();
+
+		auto& keys = std::get<vector<const SampleType*>>(sidechainChannels);
+		if (keyed) {
+			for (int ch = 0; ch < numChannels; ++ch) keys[ch] = sidechain[ch % numSidechainChannels];
 		}
+
+		auto silent = isSilent(channels, numChannels, numSamples)
+					  && (!keyed || isSilent(sidechain, numSidechainChannels, numSamples));
+		auto idle = silent && silentSamples >= tailSamples && isSettled();
+		silentSamples = silent ? std::min(silentSamples + numSamples, tailSamples) : 0;
+
+		if (idle) {
+			for (int ch = 0; ch < numChannels; ++ch) std::fill(channels[ch], channels[ch] + numSamples, SampleType(0));
+			publishMeters(numChannels, numSamples);
+			return;
+		}
+
+		// The links cover every prepared channel; skip them if the host hands
+		// over fewer, rather than linking against stale levels.
+		auto* links = numChannels == nChannels ? activeLinks() : nullptr;
+
+		for (int offset = 0; offset < numSamples; offset += maxBlock) {
+			auto n = std::min(maxBlock, numSamples - offset);
+
+			choosePaths();
+			fillRamps(n);
+
+			for (int group = 0; group < groups; ++group) {
+				interleave(channels, group * simdLanes, numChannels, offset, groupSlice(dryBuffer, group), n);
+				inputLevel.accumulateWithClips(groupSlice(dryBuffer, group), n);
+				if (keyed) interleave(keys.data(), group * simdLanes, numChannels, offset, groupSlice(sidechainBuffer, group), n);
+			}
+
+			if (!bypassed) {
+				splitBands(groups, n);
+				if (keyed) splitSidechain(groups, n);
+
+				for (int b = 0; b < NumBands; ++b) {
+					if (bandPaths[b] != BandPath::off) processBand(b, links, groups, n);
+				}
+			}
+
+			if (!bypassed) sumBands(groups, n);
+
+			for (int group = 0; group < groups; ++group) {
+				if (bypassed) passDry(group, n);
+				outputLevel.accumulateWithClips(groupSlice(dryBuffer, group), n);
+				deinterleave(groupSlice(dryBuffer, group), channels, group * simdLanes, numChannels, offset, n);
+			}
+		}
+
+		publishMeters(numChannels, numSamples);
 	}
 };
 
-#undef DEFAULT_SR
\ No newline at end of file
+#undef DEFAULT_SR
+#undef MAX_CHUNK_SIZE
+#undef MAX_LOOKAHEAD_MS
+#undef MAX_RMS_WINDOW_MS
+#undef KNEE_MIN_WIDTH
\ No newline at end of file
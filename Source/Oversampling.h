@@ -0,0 +1,258 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+using std::vector;
+
+#include "Utils.h"
+#include "Filters.h"
+
+constexpr int maxOversamplingStages = 3;
+constexpr int maxOversampling = 1 << maxOversamplingStages;
+
+// One 2x step: a linear phase halfband FIR (Kaiser windowed sinc) of length
+// 4k + 3. Apart from the centre tap every other coefficient is zero, so the
+// upsampler is a 2k + 2 tap FIR for the even outputs and a pure delay for the
+// odd ones, and the downsampler is the mirror image. Up and down together
+// delay the signal by 2k + 1 samples at the lower rate.
+template <typename T>
+class HalfbandStage
+{
+	int k{ 0 };
+	int historySize{ 1 };
+	int maxInput{ 0 };
+
+	// The nonzero side taps h[0], h[2], ... h[4k + 2], which are symmetric,
+	// and the same doubled for the upsampler (zero stuffing halves the level).
+	vector<float> taps;
+	vector<float> upTaps;
+
+	// Per lane group history, group g at g * historySize.
+	vector<T> upHistory;
+	vector<T> evenHistory;
+	vector<T> oddHistory;
+
+	// History followed by the current block.
+	vector<T> upWork;
+	vector<T> evenWork;
+	vector<T> oddWork;
+
+public:
+
+	void design(int halfLength, double beta) {
+		k = halfLength;
+		historySize = 2 * k + 1;
+
+		auto length = 4 * k + 3;
+		auto centre = 2 * k + 1;
+		taps.assign(2 * k + 2, 0.0f);
+
+		double sum = 0.0;
+		vector<double> h(taps.size());
+		for (int m = 0; m < 2 * k + 2; ++m) {
+			auto n = 2 * m - centre;
+			auto x = static_cast<double>(2 * m) / (length - 1) * 2.0 - 1.0;
+			auto window = besselI0(beta * std::sqrt(1.0 - x * x)) / besselI0(beta);
+			h[m] = std::sin(0.5 * 3.14159265358979323846 * n) / (3.14159265358979323846 * n) * window;
+			sum += h[m];
+		}
+
+		// The side taps carry half the DC gain, the centre tap (0.5) the rest.
+		upTaps.resize(taps.size());
+		for (size_t m = 0; m < h.size(); ++m) {
+			taps[m] = static_cast<float>(0.5 * h[m] / sum);
+			upTaps[m] = 2.0f * taps[m];
+		}
+	}
+
+	void prepare(int maxInputSamples, int numGroups) {
+		maxInput = maxInputSamples;
+		upHistory.assign(static_cast<size_t>(historySize) * numGroups, T(0.0f));
+		evenHistory.assign(static_cast<size_t>(historySize) * numGroups, T(0.0f));
+		oddHistory.assign(static_cast<size_t>(k + 1) * numGroups, T(0.0f));
+
+		upWork.assign(static_cast<size_t>(historySize + maxInput), T(0.0f));
+		evenWork.assign(static_cast<size_t>(historySize + maxInput), T(0.0f));
+		oddWork.assign(static_cast<size_t>(k + 1 + maxInput), T(0.0f));
+	}
+
+	void reset() {
+		std::fill(upHistory.begin(), upHistory.end(), T(0.0f));
+		std::fill(evenHistory.begin(), evenHistory.end(), T(0.0f));
+		std::fill(oddHistory.begin(), oddHistory.end(), T(0.0f));
+	}
+
+	// Only lane groups first .. first + count - 1.
+	void reset(int first, int count) {
+		std::fill(upHistory.begin() + first * historySize, upHistory.begin() + (first + count) * historySize, T(0.0f));
+		std::fill(evenHistory.begin() + first * historySize, evenHistory.begin() + (first + count) * historySize, T(0.0f));
+		std::fill(oddHistory.begin() + first * (k + 1), oddHistory.begin() + (first + count) * (k + 1), T(0.0f));
+	}
+
+	// Round trip delay in samples at the lower rate.
+	int getLatency() const {
+		return 2 * k + 1;
+	}
+
+	// numSamples in, 2 * numSamples out.
+	void upsample(int group, const T* input, T* output, int numSamples) {
+		jassert(numSamples <= maxInput);
+
+		auto* history = upHistory.data() + group * historySize;
+		auto* x = upWork.data() + historySize;
+		std::copy(history, history + historySize, upWork.data());
+		std::copy(input, input + numSamples, x);
+
+		auto* h = upTaps.data();
+		auto last = 2 * k + 1;
+		for (int i = 0; i < numSamples; ++i) {
+			T even(0.0f);
+			for (int m = 0; m <= k; ++m) {
+				even = even + (x[i - m] + x[i - last + m]) * h[m];
+			}
+			output[2 * i] = even;
+			output[2 * i + 1] = x[i - k];
+		}
+
+		std::copy(x + numSamples - historySize, x + numSamples, history);
+	}
+
+	// 2 * numSamples in, numSamples out.
+	void downsample(int group, const T* input, T* output, int numSamples) {
+		jassert(numSamples <= maxInput);
+
+		auto* even = evenWork.data() + historySize;
+		auto* odd = oddWork.data() + k + 1;
+		auto* eHistory = evenHistory.data() + group * historySize;
+		auto* oHistory = oddHistory.data() + group * (k + 1);
+		std::copy(eHistory, eHistory + historySize, evenWork.data());
+		std::copy(oHistory, oHistory + k + 1, oddWork.data());
+
+		for (int i = 0; i < numSamples; ++i) {
+			even[i] = input[2 * i];
+			odd[i] = input[2 * i + 1];
+		}
+
+		auto* h = taps.data();
+		auto last = 2 * k + 1;
+		for (int i = 0; i < numSamples; ++i) {
+			T sum = odd[i - k - 1] * 0.5f;
+			for (int m = 0; m <= k; ++m) {
+				sum = sum + (even[i - m] + even[i - last + m]) * h[m];
+			}
+			output[i] = sum;
+		}
+
+		std::copy(even + numSamples - historySize, even + numSamples, eHistory);
+		std::copy(odd + numSamples - (k + 1), odd + numSamples, oHistory);
+	}
+};
+
+// 1x, 2x, 4x or 8x as a chain of halfband stages. The first stage sees the
+// full band and gets the long filter; later stages only have to reject images
+// far from the signal and are much shorter. A short delay at the top rate
+// rounds the round trip latency up to whole samples at the base rate, so other
+// bands can be aligned with a plain delay line.
+template <typename T>
+class Oversampler
+{
+	HalfbandStage<T> stages[maxOversamplingStages];
+	DelayLine<T> padding;
+	int numStages{ 0 };
+	int latency{ 0 };
+	int maxBlock{ 0 };
+
+	// Ping-pong buffers between stages; only used within one call.
+	vector<T> scratchA;
+	vector<T> scratchB;
+
+	// Round trip latency of the first numStages stages, in top rate samples.
+	int topRateLatency(int count) const {
+		int total = 0;
+		for (int i = 0; i < count; ++i) {
+			total += stages[i].getLatency() << (count - i);
+		}
+		return total;
+	}
+
+public:
+
+	Oversampler() {
+		stages[0].design(12, 8.0);
+		stages[1].design(5, 8.0);
+		stages[2].design(3, 7.0);
+	}
+
+	void prepare(int maxBlockSize, int numGroups) {
+		maxBlock = maxBlockSize;
+		for (int i = 0; i < maxOversamplingStages; ++i) {
+			stages[i].prepare(maxBlock << i, numGroups);
+		}
+		padding.prepare(maxOversampling, numGroups);
+
+		scratchA.assign(static_cast<size_t>(maxBlock) * maxOversampling / 2, T(0.0f));
+		scratchB.assign(static_cast<size_t>(maxBlock) * maxOversampling / 2, T(0.0f));
+	}
+
+	// 1, 2, 4 or 8. Clears the filter state, since the stages change.
+	void setFactor(int factor) {
+		numStages = 0;
+		while ((1 << numStages) < factor && numStages < maxOversamplingStages) ++numStages;
+
+		auto top = 1 << numStages;
+		auto total = topRateLatency(numStages);
+		auto pad = (top - total % top) % top;
+		padding.setDelay(pad);
+		latency = (total + pad) / top;
+
+		reset();
+	}
+
+	int getFactor() const {
+		return 1 << numStages;
+	}
+
+	// Round trip latency in base rate samples.
+	int getLatency() const {
+		return latency;
+	}
+
+	// Latency at the highest factor, for sizing delay lines.
+	int getMaxLatency() const {
+		auto top = maxOversampling;
+		auto total = topRateLatency(maxOversamplingStages);
+		return (total + top - 1) / top;
+	}
+
+	void reset() {
+		for (auto& stage : stages) stage.reset();
+		padding.reset();
+	}
+
+	void reset(int first, int count) {
+		for (auto& stage : stages) stage.reset(first, count);
+		padding.reset(first, count);
+	}
+
+	// numSamples in, numSamples * getFactor() out.
+	void upsample(int group, const T* input, T* output, int numSamples) {
+		const T* in = input;
+		for (int i = 0; i < numStages; ++i) {
+			auto* out = i == numStages - 1 ? output : (i % 2 == 0 ? scratchA.data() : scratchB.data());
+			stages[i].upsample(group, in, out, numSamples << i);
+			in = out;
+		}
+	}
+
+	// numSamples * getFactor() in, numSamples out. The input is modified.
+	void downsample(int group, T* input, T* output, int numSamples) {
+		padding.process(group, input, numSamples << numStages);
+
+		const T* in = input;
+		for (int i = numStages - 1; i >= 0; --i) {
+			auto* out = i == 0 ? output : (i % 2 == 0 ? scratchA.data() : scratchB.data());
+			stages[i].downsample(group, in, out, numSamples << i);
+			in = out;
+		}
+	}
+};
@@ -0,0 +1,131 @@
+/*
+  ==============================================================================
+
+    ParameterSpecs.h
+    IDs, names, ranges and defaults of the host parameters, shared by the
+    plugin and the command line tools.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+#include "DSPParameters.h"
+
+// How a host parameter becomes the float the engine reads; one per
+// APVTSParameter type.
+enum class ParameterKind
+{
+    value,          // APVTSParameterFloat: the value itself
+    toggle,         // APVTSParameterBool: 0 or 1
+    choice,         // APVTSParameterChoice: the number the choice names
+    choiceIndex     // APVTSParameterChoiceIndex: the index of the choice
+};
+
+struct ParameterSpec
+{
+    juce::String id;
+    juce::String name;
+    ParameterKind kind{ ParameterKind::value };
+    juce::NormalisableRange<float> range;
+    juce::StringArray choices;
+
+    // In host units: the value, 0 or 1, or the index of the choice.
+    float defaultValue{ 0.0f };
+
+    bool isUsed() const {
+        return id.isNotEmpty();
+    }
+
+    // The engine value for a host value, as APVTSParameter::get() computes it.
+    float toEngine(float hostValue) const {
+        switch (kind) {
+            case ParameterKind::value:       return range.snapToLegalValue(hostValue);
+            case ParameterKind::toggle:      return hostValue >= 0.5f ? 1.0f : 0.0f;
+            case ParameterKind::choice:      return choices[juce::jlimit(0, choices.size() - 1, juce::roundToInt(hostValue))].getFloatValue();
+            case ParameterKind::choiceIndex: return static_cast<float>(juce::jlimit(0, choices.size() - 1, juce::roundToInt(hostValue)));
+        }
+        return hostValue;
+    }
+};
+
+using ParameterSpecs = std::array<ParameterSpec, PARAMETER_COUNT>;
+
+// The 3-band build keeps the original Low/Mid/High IDs so existing sessions
+// and automation still load.
+inline juce::String bandSuffix(int band) {
+    if (numBands == 3) return juce::StringArray{ "Low", "Mid", "High" }[band];
+    return juce::String(band + 1);
+}
+
+inline juce::String crossoverID(int index) {
+    if (numBands == 3) return bandSuffix(index).toLowerCase() + bandSuffix(index + 1) + "Cut";
+    return "crossover" + juce::String(index + 1);
+}
+
+inline juce::String crossoverName(int index) {
+    if (numBands == 3) return bandSuffix(index) + "/" + bandSuffix(index + 1) + " Cut";
+    return "Crossover " + juce::String(index + 1);
+}
+
+// Built once from numBands; slots for bands past numBands stay unused.
+inline const ParameterSpecs& parameterSpecs() {
+    static const ParameterSpecs specs = [] {
+        ParameterSpecs s;
+
+        auto set = [&](int index, const juce::String& id, const juce::String& name, ParameterKind kind,
+                       juce::NormalisableRange<float> range, float defaultValue, juce::StringArray choices = {}) {
+            if (!choices.isEmpty()) range = { 0.0f, static_cast<float>(choices.size() - 1), 1.0f };
+            s[index] = { id, name, kind, range, choices, defaultValue };
+        };
+
+        auto gainRange = juce::NormalisableRange<float>{ -60.0f, 12.0f, 1.0f };
+        auto timeRange = juce::NormalisableRange<float>{ 5.0f, 5000.0f, 1.0f };
+        auto toggleRange = juce::NormalisableRange<float>{ 0.0f, 1.0f, 1.0f };
+        auto ratios = juce::StringArray{ "1", "1.5", "2", "3", "4", "5", "6", "7", "8", "10", "15", "20", "50", "100" };
+
+        for (int b = 0; b < numBands; ++b) {
+            auto id = bandSuffix(b);
+            auto name = " " + bandSuffix(b);
+
+            set(THRESHOLD + b,   "threshold" + id, "Threshold" + name, ParameterKind::value,  gainRange,   0.0f);
+            set(RATIO + b,       "ratio" + id,     "Ratio" + name,     ParameterKind::choice, {},          3.0f, ratios);
+            set(ATTACK + b,      "attack" + id,    "Attack" + name,    ParameterKind::value,  timeRange,   50.0f);
+            set(RELEASE + b,     "release" + id,   "Release" + name,   ParameterKind::value,  timeRange,   250.0f);
+            set(BAND_INPUT + b,  "input" + id,     "Input" + name,     ParameterKind::value,  gainRange,   0.0f);
+            set(BAND_OUTPUT + b, "output" + id,    "Output" + name,    ParameterKind::value,  gainRange,   0.0f);
+            set(MUTE + b,        "mute" + id,      "Mute" + name,      ParameterKind::toggle, toggleRange, 0.0f);
+
+            set(OVERSAMPLING + b, "oversampling" + id, "Oversampling" + name, ParameterKind::choiceIndex, {}, 0.0f,
+                { "Off", "2x", "4x", "8x" });
+            set(LOOKAHEAD + b,    "lookahead" + id,    "Lookahead" + name,    ParameterKind::value,
+                { 0.0f, 10.0f, 0.1f }, 0.0f);
+            set(DETECTOR + b,     "detector" + id,     "Detector" + name,     ParameterKind::choiceIndex, {}, 0.0f,
+                { "Peak", "RMS" });
+            set(RMS_WINDOW + b,   "rmsWindow" + id,    "RMS Window" + name,   ParameterKind::value,
+                { 1.0f, 300.0f, 0.1f, 0.4f }, 10.0f);
+            set(KNEE + b,         "knee" + id,         "Knee" + name,         ParameterKind::value,
+                { 0.0f, 24.0f, 0.1f }, 0.0f);
+        }
+
+        for (int i = 0; i < numBands - 1; ++i) {
+            set(CROSSOVER + i, crossoverID(i), crossoverName(i), ParameterKind::value,
+                { 20.0f, 20000.0f, 1.0f, 0.3f }, defaultCrossoverFrequency(numBands, i));
+        }
+
+        set(INPUT_ALL,      "inputAll",      "Input",          ParameterKind::value,       gainRange,   0.0f);
+        set(OUTPUT_ALL,     "outputAll",     "Output",         ParameterKind::value,       gainRange,   0.0f);
+        set(BYPASS,         "bypass",        "Bypass",         ParameterKind::toggle,      toggleRange, 0.0f);
+        set(LINK_MODE,      "linkMode",      "Link Mode",      ParameterKind::choiceIndex, {}, 0.0f,
+            { "Unlinked", "Linked", "Grouped" });
+        set(CROSSOVER_MODE, "crossoverMode", "Crossover Mode", ParameterKind::choiceIndex, {}, 0.0f,
+            { "IIR", "Linear Phase" });
+
+        return s;
+    }();
+
+    return specs;
+}
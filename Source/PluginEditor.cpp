@@ -9,32 +9,100 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+static ParameterLookup parameterLookup (MultibandCompressorAudioProcessor& p)
+{
+    return [&p] (int index) -> RangedAudioParameter& { return *p.getDSPParameter (index); };
+}
+
+static vector<RangedAudioParameter*> crossoverParameters (MultibandCompressorAudioProcessor& p)
+{
+    vector<RangedAudioParameter*> crossovers;
+    for (int i = 0; i < numBands - 1; ++i)
+        crossovers.push_back (p.getDSPParameter (CROSSOVER + i));
+    return crossovers;
+}
+
 //==============================================================================
 MultibandCompressorAudioProcessorEditor::MultibandCompressorAudioProcessorEditor (MultibandCompressorAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
+    : AudioProcessorEditor (&p), audioProcessor (p),
+      spectrum (p.getAnalyzer(), crossoverParameters (p)),
+      global (p.getMeters(), parameterLookup (p)),
+      frameClock (*this)
 {
-    // Make sure that before the constructor has finished, you've set the
-    // editor's size to whatever you need it to be.
-    setSize (400, 300);
+    setOpaque (true);
+
+    addAndMakeVisible (spectrum);
+    frameClock.add (spectrum);
+
+    auto lookup = parameterLookup (p);
+    for (int b = 0; b < numBands; ++b)
+    {
+        auto* panel = bandPanels.add (new BandPanel (MultibandCompressorAudioProcessor::getBandName (b),
+                                                     TrioColours::band (b, numBands),
+                                                     p.getMeters().bands[b], lookup, b));
+        addAndMakeVisible (panel);
+        frameClock.add (*panel);
+    }
+
+    addAndMakeVisible (global);
+    frameClock.add (global);
+
+    savePresetButton.onClick = [this] { askForPresetName(); };
+    addAndMakeVisible (savePresetButton);
+
+    // After every child is in place, so they all pick it up.
+    setLookAndFeel (&lookAndFeel);
+
+    setSize (numBands * BandPanel::preferredWidth + GlobalPanel::preferredWidth,
+             220 + BandPanel::preferredHeight);
 }
 
 MultibandCompressorAudioProcessorEditor::~MultibandCompressorAudioProcessorEditor()
 {
+    setLookAndFeel (nullptr);
 }
 
 //==============================================================================
 void MultibandCompressorAudioProcessorEditor::paint (Graphics& g)
 {
-    // (Our component is opaque, so we must completely fill the background with a solid colour)
     g.fillAll (getLookAndFeel().findColour (ResizableWindow::backgroundColourId));
-
-    g.setColour (Colours::white);
-    g.setFont (FontOptions (15.0f));
-    g.drawFittedText ("Hello World!", getLocalBounds(), Justification::centred, 1);
 }
 
+// Global controls and the preset button on the right; the spectrum over the
+// band panels on the left.
 void MultibandCompressorAudioProcessorEditor::resized()
 {
-    // This is generally where you'll want to lay out the positions of any
-    // subcomponents in your editor..
+    auto bounds = getLocalBounds();
+    auto column = bounds.removeFromRight (GlobalPanel::preferredWidth);
+    savePresetButton.setBounds (column.removeFromBottom (30).reduced (8, 3));
+    global.setBounds (column.reduced (1));
+
+    spectrum.setBounds (bounds.removeFromTop (220).reduced (1));
+
+    auto bandWidth = bounds.getWidth() / jmax (1, bandPanels.size());
+    for (auto* panel : bandPanels)
+        panel->setBounds (bounds.removeFromLeft (bandWidth).reduced (1));
+}
+
+// Saves the current settings to the preset library, which is also the host's
+// program list, under a name the user picks. A preset of the same name is
+// replaced.
+void MultibandCompressorAudioProcessorEditor::askForPresetName()
+{
+    auto* window = new AlertWindow ("Save Preset", "Name of the preset:", MessageBoxIconType::NoIcon, this);
+    window->addTextEditor ("name", audioProcessor.getProgramName (audioProcessor.getCurrentProgram()));
+    window->addButton ("Save", 1, KeyPress (KeyPress::returnKey));
+    window->addButton ("Cancel", 0, KeyPress (KeyPress::escapeKey));
+
+    Component::SafePointer<MultibandCompressorAudioProcessorEditor> editor (this);
+    window->enterModalState (true, ModalCallbackFunction::create ([editor, window] (int result)
+    {
+        auto name = window->getTextEditorContents ("name").trim();
+        if (editor == nullptr || result == 0 || name.isEmpty())
+            return;
+
+        if (editor->audioProcessor.savePreset (name) < 0)
+            AlertWindow::showMessageBoxAsync (MessageBoxIconType::WarningIcon, "Save Preset",
+                                              "Could not write the preset file.", {}, editor.getComponent());
+    }), true);
 }
@@ -10,6 +10,8 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "GUIComponents.h"
+#include "LookAndFeel.h"
 
 //==============================================================================
 /**
@@ -29,5 +31,17 @@ private:
     // access the processor object that created it.
     MultibandCompressorAudioProcessor& audioProcessor;
 
+    TrioLookAndFeel lookAndFeel;
+
+    SpectrumDisplay spectrum;
+    OwnedArray<BandPanel> bandPanels;
+    GlobalPanel global;
+    TextButton savePresetButton { "Save Preset" };
+
+    void askForPresetName();
+
+    // Declared last so it stops before the displays it drives go away.
+    FrameClock frameClock;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MultibandCompressorAudioProcessorEditor)
 };
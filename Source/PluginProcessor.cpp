@@ -7,6 +7,7 @@ MultibandCompressorAudioProcessor::MultibandCompressorAudioProcessor()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", AudioChannelSet::stereo(), false)
                       #endif
                        .withOutput ("Output", AudioChannelSet::stereo(), true)
                      #endif
@@ -15,15 +16,23 @@ MultibandCompressorAudioProcessor::MultibandCompressorAudioProcessor()
     compressor()
 #endif
 {
-    apvts.state.addListener(this);
-    for (auto& param : apvtsParameters) {
+    for (int i = 0; i < ParameterNames::PARAMETER_COUNT; ++i) {
+        auto& param = apvtsParameters[i];
+        if (param == nullptr) continue;
         param->castParameter(apvts);
+
+        auto* processorParameter = apvts.getParameter(param->id.getParamID());
+        jassert(isPositiveAndBelow(processorParameter->getParameterIndex(), (int) ParameterNames::PARAMETER_COUNT));
+        hostIndexToName[processorParameter->getParameterIndex()] = i;
+        processorParameter->addListener(this);
     }
 }
 
 MultibandCompressorAudioProcessor::~MultibandCompressorAudioProcessor()
 {
-    apvts.state.removeListener(this);
+    for (auto& param : apvtsParameters) {
+        if (param != nullptr) apvts.getParameter(param->id.getParamID())->removeListener(this);
+    }
 }
 
 const String MultibandCompressorAudioProcessor::getName() const
@@ -58,54 +67,107 @@ bool MultibandCompressorAudioProcessor::isMidiEffect() const
    #endif
 }
 
+// How long the output rings and the envelopes release after the input
+// stops; hosts that suspend silent plugins wait this long.
 double MultibandCompressorAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return tailSeconds.load(std::memory_order_relaxed);
 }
 
+// The programs are the presets in the library; hosts expect at least one.
 int MultibandCompressorAudioProcessor::getNumPrograms()
 {
-    return 1;   
+    return jmax(1, presets.size());
 }
 
 int MultibandCompressorAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentPreset;
 }
 
 void MultibandCompressorAudioProcessor::setCurrentProgram (int index)
 {
+    PresetValues values;
+    if (!presets.load(index, values)) return;
+
+    currentPreset = index;
+    applyPreset(values);
 }
 
 const String MultibandCompressorAudioProcessor::getProgramName (int index)
 {
-    return {};
+    return presets.getName(index);
 }
 
 void MultibandCompressorAudioProcessor::changeProgramName (int index, const String& newName)
 {
 }
 
+//==============================================================================
+// Detector groups for the Grouped link mode: channels with the same role in
+// the layout (front pair, side surrounds, rear surrounds, each height layer)
+// share a detector, centre and LFE stay on their own, discrete channels pair up.
+static vector<int> channelGroupsForLayout(const AudioChannelSet& layout)
+{
+    vector<int> groups;
+
+    for (int ch = 0; ch < layout.size(); ++ch) {
+        switch (layout.getTypeOfChannel(ch)) {
+            case AudioChannelSet::left:
+            case AudioChannelSet::right:
+            case AudioChannelSet::leftCentre:
+            case AudioChannelSet::rightCentre:
+            case AudioChannelSet::wideLeft:
+            case AudioChannelSet::wideRight:         groups.push_back(0); break;
+            case AudioChannelSet::centre:            groups.push_back(1); break;
+            case AudioChannelSet::LFE:
+            case AudioChannelSet::LFE2:              groups.push_back(2); break;
+            case AudioChannelSet::leftSurround:
+            case AudioChannelSet::rightSurround:
+            case AudioChannelSet::leftSurroundSide:
+            case AudioChannelSet::rightSurroundSide: groups.push_back(3); break;
+            case AudioChannelSet::leftSurroundRear:
+            case AudioChannelSet::rightSurroundRear:
+            case AudioChannelSet::centreSurround:    groups.push_back(4); break;
+            case AudioChannelSet::topFrontLeft:
+            case AudioChannelSet::topFrontRight:
+            case AudioChannelSet::topFrontCentre:    groups.push_back(5); break;
+            case AudioChannelSet::topSideLeft:
+            case AudioChannelSet::topSideRight:
+            case AudioChannelSet::topMiddle:         groups.push_back(6); break;
+            case AudioChannelSet::topRearLeft:
+            case AudioChannelSet::topRearRight:
+            case AudioChannelSet::topRearCentre:     groups.push_back(7); break;
+            default:                                 groups.push_back(8 + ch / 2); break;
+        }
+    }
+
+    return groups;
+}
+
 //==============================================================================
 void MultibandCompressorAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    int nChannels = getTotalNumInputChannels();
+    int nChannels = getMainBusNumInputChannels();
 
-    compressorParameters.set("sampleRate", sampleRate);
-    compressorParameters.set("blockSize", samplesPerBlock);
-    compressorParameters.set("nChannels", nChannels);
+    compressor.setChannelGroups(channelGroupsForLayout(getChannelLayoutOfBus(true, 0)));
 
-    for (auto& param : apvtsParameters) {
-        compressorParameters.set(param->id.getParamID().toStdString(), param->getDefault());
+    for (int i = 0; i < ParameterNames::PARAMETER_COUNT; ++i) {
+        if (apvtsParameters[i] != nullptr) compressorParameters.set(i, apvtsParameters[i]->get());
     }
+    compressorParameters.clearDirty();
 
-    compressor.prepare(compressorParameters);
+    compressor.prepare(static_cast<float>(sampleRate), samplesPerBlock, nChannels, compressorParameters);
+    setLatencySamples(compressor.getLatencySamples());
+    tailSeconds.store(compressor.getTailSamples() / sampleRate, std::memory_order_relaxed);
 
+    analyzer.prepare(sampleRate, samplesPerBlock);
 }
 
 void MultibandCompressorAudioProcessor::releaseResources()
 {
-
+    compressor.release();
+    analyzer.release();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -115,18 +177,23 @@ bool MultibandCompressorAudioProcessor::isBusesLayoutSupported (const BusesLayou
     ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+    // Any layout from mono up to 7.1.4. The engine runs channels in SIMD lane
+    // groups, so the channel count only changes how many groups run.
+    auto mainOutput = layouts.getMainOutputChannelSet();
+    if (mainOutput.isDisabled() || mainOutput.size() > maxChannels)
         return false;
 
     // This checks if the input layout matches the output layout
    #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
+
+    // The sidechain is off, mono (keys every channel) or matches the main bus.
+    if (layouts.inputBuses.size() > 1) {
+        auto sidechain = layouts.getChannelSet(true, 1);
+        if (!sidechain.isDisabled() && sidechain.size() != 1 && sidechain != mainOutput)
+            return false;
+    }
    #endif
 
     return true;
@@ -134,41 +201,92 @@ bool MultibandCompressorAudioProcessor::isBusesLayoutSupported (const BusesLayou
 }
 #endif
 
+// Copies a staged parameter set, then the parameters flagged since the last
+// block, into the table and lets the engine apply the ones that changed. No
+// allocations, no string lookups.
 void MultibandCompressorAudioProcessor::updateDSP()
 {
+    if (auto* staged = stagedParameters.take()) {
+        for (int i = 0; i < ParameterNames::PARAMETER_COUNT; ++i) {
+            if (apvtsParameters[i] != nullptr && (*staged)[i] != compressorParameters[i])
+                compressorParameters.set(i, (*staged)[i]);
+        }
+    }
 
-    for (auto& param : apvtsParameters) {
-        compressorParameters.set(param->id.getParamID().toStdString(), param->get());
+    for (int word = 0; word < parameterMaskWords; ++word) {
+        auto changed = parameterChanges.take(word);
+
+        for (int bit = 0; changed != 0; ++bit, changed >>= 1) {
+            if (changed & 1) {
+                auto index = word * 64 + bit;
+                auto value = apvtsParameters[index]->get();
+                if (value != compressorParameters[index]) compressorParameters.set(index, value);
+            }
+        }
     }
 
-    compressor.update(compressorParameters);
+    if (compressorParameters.anyDirty()) {
+        compressor.update(compressorParameters);
+        compressorParameters.clearDirty();
+        tailSeconds.store(compressor.getTailSamples() / getSampleRate(), std::memory_order_relaxed);
+    }
 }
 
-void MultibandCompressorAudioProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
+// The sidechain keys the detectors while the host has its bus enabled; the
+// key split costs nothing otherwise.
+template <typename SampleType>
+void MultibandCompressorAudioProcessor::process(AudioBuffer<SampleType>& buffer)
 {
     ScopedNoDenormals noDenormals;
-    auto totalNumInputChannels  = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
+    auto mainBuffer = getBusBuffer(buffer, true, 0);
+    auto totalNumInputChannels  = mainBuffer.getNumChannels();
+    auto totalNumOutputChannels = getMainBusNumOutputChannels();
 
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    bool expected = true;
-    
-    if (isNonRealtime() || parametersChanged.compare_exchange_strong(expected, false)) {
-        updateDSP();
+    // No channels while the host has the sidechain bus disabled.
+    auto sidechainBuffer = getBusCount(true) > 1 ? getBusBuffer(buffer, true, 1) : AudioBuffer<SampleType>();
+    auto sidechainChannels = sidechainBuffer.getNumChannels();
+
+    updateDSP();
+
+    // The per-band oversampling and lookahead settings change the latency,
+    // and so does a crossover mode switch, which can land between updates.
+    if (compressor.getLatencySamples() != getLatencySamples()) {
+        setLatencySamples(compressor.getLatencySamples());
+        tailSeconds.store(compressor.getTailSamples() / getSampleRate(), std::memory_order_relaxed);
     }
 
-    float* outputBuffers[2] = { nullptr, nullptr };
-    outputBuffers[0] = buffer.getWritePointer(0);
-    if (totalNumOutputChannels > 1) outputBuffers[1] = buffer.getWritePointer(1);
+    analyzer.captureInput(mainBuffer.getArrayOfReadPointers(), totalNumInputChannels, mainBuffer.getNumSamples());
 
     compressor.processBlock(
-        outputBuffers,
-        buffer.getNumChannels(),
-        buffer.getNumSamples()
+        mainBuffer.getArrayOfWritePointers(),
+        totalNumInputChannels,
+        sidechainChannels > 0 ? sidechainBuffer.getArrayOfReadPointers() : nullptr,
+        sidechainChannels,
+        mainBuffer.getNumSamples()
     );
 
+    analyzer.captureOutput(mainBuffer.getArrayOfReadPointers(), totalNumInputChannels, mainBuffer.getNumSamples());
+
+}
+
+void MultibandCompressorAudioProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer&)
+{
+    process(buffer);
+}
+
+// A 64-bit host buffer is converted while it is packed into SIMD lanes, a
+// copy the engine makes anyway, instead of by the host around the call.
+void MultibandCompressorAudioProcessor::processBlock (AudioBuffer<double>& buffer, MidiBuffer&)
+{
+    process(buffer);
+}
+
+bool MultibandCompressorAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
 }
 
 //==============================================================================
@@ -179,212 +297,129 @@ bool MultibandCompressorAudioProcessor::hasEditor() const
 
 AudioProcessorEditor* MultibandCompressorAudioProcessor::createEditor()
 {
-    //return new MultibandCompressorAudioProcessorEditor (*this);
-    return new GenericAudioProcessorEditor (*this);
+    return new MultibandCompressorAudioProcessorEditor (*this);
 }
 
+// The binary preset format (see PresetManager.h): a few hundred bytes, read
+// without parsing any text.
 void MultibandCompressorAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
 {
-    copyXmlToBinary(*apvts.copyState().createXml(), destData);
+    writePreset(currentPresetValues(), destData);
 }
 
+// Also reads the XML state that earlier versions saved.
 void MultibandCompressorAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
 {
-    std::unique_ptr<juce::XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
-    if (xml.get() != nullptr && xml->hasTagName(apvts.state.getType())) {
-        apvts.replaceState(juce::ValueTree::fromXml(*xml));
-        parametersChanged.store(true);
+    auto values = defaultPresetValues();
+    if (sizeInBytes > 0 && readAnyPreset(data, static_cast<size_t>(sizeInBytes), values))
+        applyPreset(values);
+}
+
+PresetValues MultibandCompressorAudioProcessor::currentPresetValues() const
+{
+    auto values = defaultPresetValues();
+    for (int i = 0; i < ParameterNames::PARAMETER_COUNT; ++i) {
+        if (auto* parameter = apvts.getParameter(parameterSpecs()[i].id))
+            values[i] = parameter->convertFrom0to1(parameter->getValue());
     }
+    return values;
 }
 
-juce::AudioProcessorValueTreeState::ParameterLayout MultibandCompressorAudioProcessor::createParameterLayout()
+// The engine gets the whole set at once through the stage, so no block runs
+// with half a preset, and its smoothers glide to the new values. Only host
+// parameters whose value differs are then moved, so the host, the editor and
+// the parameter tree are notified of actual changes only.
+void MultibandCompressorAudioProcessor::applyPreset(const PresetValues& values)
 {
-    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+    stagedParameters.stage(engineParameters(values));
 
-    layout.add(std::make_unique <juce::AudioParameterFloat>(
-        apvtsParameters[ParameterNames::THRESHOLD_LOW]->id,
-        apvtsParameters[ParameterNames::THRESHOLD_LOW]->displayValue,
-        juce::NormalisableRange<float>{ -60.0f, 12.0f, 1.0f },
-        apvtsParameters[ParameterNames::THRESHOLD_LOW]->getDefault()
-    ));
-
-    layout.add(std::make_unique <juce::AudioParameterFloat>(
-        apvtsParameters[ParameterNames::THRESHOLD_MID]->id,
-        apvtsParameters[ParameterNames::THRESHOLD_MID]->displayValue,
-        juce::NormalisableRange<float>{ -60.0f, 12.0f, 1.0f},
-        apvtsParameters[ParameterNames::THRESHOLD_MID]->getDefault()
-    ));
-
-    layout.add(std::make_unique <juce::AudioParameterFloat>(
-        apvtsParameters[ParameterNames::THRESHOLD_HIGH]->id,
-        apvtsParameters[ParameterNames::THRESHOLD_HIGH]->displayValue,
-        juce::NormalisableRange<float>{ -60.0f, 12.0f, 1.0f},
-        apvtsParameters[ParameterNames::THRESHOLD_HIGH]->getDefault()
-    ));
-
-    auto ratios = StringArray{ "1", "1.5", "2", "3", "4", "5", "6", "7", "8", "10", "15", "20", "50", "100" };
-
-    layout.add(std::make_unique <juce::AudioParameterChoice>(
-        apvtsParameters[ParameterNames::RATIO_LOW]->id,
-        apvtsParameters[ParameterNames::RATIO_LOW]->displayValue,
-        ratios,
-        3
-    ));
-    
-    layout.add(std::make_unique <juce::AudioParameterChoice>(
-        apvtsParameters[ParameterNames::RATIO_MID]->id,
-        apvtsParameters[ParameterNames::RATIO_MID]->displayValue,
-        ratios,
-        3
-    ));
-    
-    layout.add(std::make_unique <juce::AudioParameterChoice>(
-        apvtsParameters[ParameterNames::RATIO_HIGH]->id,
-        apvtsParameters[ParameterNames::RATIO_HIGH]->displayValue,
-        ratios,
-        3
-    ));
-
-    layout.add(std::make_unique <juce::AudioParameterFloat>(
-        apvtsParameters[ParameterNames::ATTACK_LOW]->id,
-        apvtsParameters[ParameterNames::ATTACK_LOW]->displayValue,
-        juce::NormalisableRange<float>{ 5.0f, 5000.0f, 1.0f },
-        apvtsParameters[ParameterNames::ATTACK_LOW]->getDefault()
-    ));
-
-    layout.add(std::make_unique <juce::AudioParameterFloat>(
-        apvtsParameters[ParameterNames::ATTACK_MID]->id,
-        apvtsParameters[ParameterNames::ATTACK_MID]->displayValue,
-        juce::NormalisableRange<float>{ 5.0f, 5000.0f, 1.0f },
-        apvtsParameters[ParameterNames::ATTACK_MID]->getDefault()
-    ));
-
-
-    layout.add(std::make_unique <juce::AudioParameterFloat>(
-        apvtsParameters[ParameterNames::ATTACK_HIGH]->id,
-        apvtsParameters[ParameterNames::ATTACK_HIGH]->displayValue,
-        juce::NormalisableRange<float>{ 5.0f, 5000.0f, 1.0f },
-        apvtsParameters[ParameterNames::ATTACK_HIGH]->getDefault()
-    ));
-
-
-    layout.add(std::make_unique <juce::AudioParameterFloat>(
-        apvtsParameters[ParameterNames::RELEASE_LOW]->id,
-        apvtsParameters[ParameterNames::RELEASE_LOW]->displayValue,
-        juce::NormalisableRange<float>{ 5.0f, 5000.0f, 1.0f },
-        apvtsParameters[ParameterNames::RELEASE_LOW]->getDefault()
-    ));
-
-    layout.add(std::make_unique <juce::AudioParameterFloat>(
-        apvtsParameters[ParameterNames::RELEASE_MID]->id,
-        apvtsParameters[ParameterNames::RELEASE_MID]->displayValue,
-        juce::NormalisableRange<float>{ 5.0f, 5000.0f, 1.0f },
-        apvtsParameters[ParameterNames::RELEASE_MID]->getDefault()
-    ));
-
-
-    layout.add(std::make_unique <juce::AudioParameterFloat>(
-        apvtsParameters[ParameterNames::RELEASE_HIGH]->id,
-        apvtsParameters[ParameterNames::RELEASE_HIGH]->displayValue,
-        juce::NormalisableRange<float>{ 5.0f, 5000.0f, 1.0f },
-        apvtsParameters[ParameterNames::RELEASE_HIGH]->getDefault()
-    ));
-
-    layout.add(std::make_unique <juce::AudioParameterFloat>(
-        apvtsParameters[ParameterNames::INPUT_LOW]->id,
-        apvtsParameters[ParameterNames::INPUT_LOW]->displayValue,
-        juce::NormalisableRange<float>{ -60.0f, 12.0f, 1.0f },
-        apvtsParameters[ParameterNames::INPUT_LOW]->getDefault()
-    ));
-
-    layout.add(std::make_unique <juce::AudioParameterFloat>(
-        apvtsParameters[ParameterNames::INPUT_MID]->id,
-        apvtsParameters[ParameterNames::INPUT_MID]->displayValue,
-        juce::NormalisableRange<float>{ -60.0f, 12.0f, 1.0f },
-        apvtsParameters[ParameterNames::INPUT_MID]->getDefault()
-    ));
-
-    layout.add(std::make_unique <juce::AudioParameterFloat>(
-        apvtsParameters[ParameterNames::INPUT_HIGH]->id,
-        apvtsParameters[ParameterNames::INPUT_HIGH]->displayValue,
-        juce::NormalisableRange<float>{ -60.0f, 12.0f, 1.0f },
-        apvtsParameters[ParameterNames::INPUT_HIGH]->getDefault()
-    ));
-
-    layout.add(std::make_unique <juce::AudioParameterFloat>(
-        apvtsParameters[ParameterNames::OUTPUT_LOW]->id,
-        apvtsParameters[ParameterNames::OUTPUT_LOW]->displayValue,
-        juce::NormalisableRange<float>{ -60.0f, 12.0f, 1.0f },
-        apvtsParameters[ParameterNames::OUTPUT_LOW]->getDefault()
-    ));
-
-    layout.add(std::make_unique <juce::AudioParameterFloat>(
-        apvtsParameters[ParameterNames::OUTPUT_MID]->id,
-        apvtsParameters[ParameterNames::OUTPUT_MID]->displayValue,
-        juce::NormalisableRange<float>{ -60.0f, 12.0f, 1.0f },
-        apvtsParameters[ParameterNames::OUTPUT_MID]->getDefault()
-    ));
-
-    layout.add(std::make_unique <juce::AudioParameterFloat>(
-        apvtsParameters[ParameterNames::OUTPUT_HIGH]->id,
-        apvtsParameters[ParameterNames::OUTPUT_HIGH]->displayValue,
-        juce::NormalisableRange<float>{ -60.0f, 12.0f, 1.0f },
-        apvtsParameters[ParameterNames::OUTPUT_HIGH]->getDefault()
-    ));
-
-    layout.add(std::make_unique <juce::AudioParameterBool>(
-        apvtsParameters[ParameterNames::MUTE_LOW]->id,
-        apvtsParameters[ParameterNames::MUTE_LOW]->displayValue,
-        apvtsParameters[ParameterNames::MUTE_LOW]->getDefault()
-    ));
-    
-    layout.add(std::make_unique <juce::AudioParameterBool>(
-        apvtsParameters[ParameterNames::MUTE_MID]->id,
-        apvtsParameters[ParameterNames::MUTE_MID]->displayValue,
-        apvtsParameters[ParameterNames::MUTE_MID]->getDefault()
-    ));
-    
-    layout.add(std::make_unique <juce::AudioParameterBool>(
-        apvtsParameters[ParameterNames::MUTE_HIGH]->id,
-        apvtsParameters[ParameterNames::MUTE_HIGH]->displayValue,
-        apvtsParameters[ParameterNames::MUTE_HIGH]->getDefault()
-    ));
-
-    layout.add(std::make_unique <juce::AudioParameterFloat>(
-        apvtsParameters[ParameterNames::LOW_MID_CUT]->id,
-        apvtsParameters[ParameterNames::LOW_MID_CUT]->displayValue,
-        juce::NormalisableRange<float>{ 20.0f, 20000.0f, 1.0f, 0.3f },
-        apvtsParameters[ParameterNames::LOW_MID_CUT]->getDefault()
-    ));
-    
-    layout.add(std::make_unique <juce::AudioParameterFloat>(
-        apvtsParameters[ParameterNames::MID_HIGH_CUT]->id,
-        apvtsParameters[ParameterNames::MID_HIGH_CUT]->displayValue,
-        juce::NormalisableRange<float>{ 20.0f, 20000.0f, 1.0f, 0.3f },
-        apvtsParameters[ParameterNames::MID_HIGH_CUT]->getDefault()
-    ));
-
-
-    layout.add(std::make_unique <juce::AudioParameterFloat>(
-        apvtsParameters[ParameterNames::OUTPUT_ALL]->id,
-        apvtsParameters[ParameterNames::OUTPUT_ALL]->displayValue,
-        juce::NormalisableRange<float>{ -60.0f, 12.0f, 1.0f },
-        apvtsParameters[ParameterNames::OUTPUT_ALL]->getDefault()
-    ));
-    
-    layout.add(std::make_unique <juce::AudioParameterFloat>(
-        apvtsParameters[ParameterNames::INPUT_ALL]->id,
-        apvtsParameters[ParameterNames::INPUT_ALL]->displayValue,
-        juce::NormalisableRange<float>{ -60.0f, 12.0f, 1.0f },
-        apvtsParameters[ParameterNames::INPUT_ALL]->getDefault()
-    ));
-
-    layout.add(std::make_unique <juce::AudioParameterBool>(
-        apvtsParameters[ParameterNames::BYPASS]->id,
-        apvtsParameters[ParameterNames::BYPASS]->displayValue,
-        apvtsParameters[ParameterNames::BYPASS]->getDefault()
-    ));
+    for (int i = 0; i < ParameterNames::PARAMETER_COUNT; ++i) {
+        auto* parameter = getDSPParameter(i);
+        if (parameter == nullptr) continue;
 
+        auto normalised = parameter->convertTo0to1(values[i]);
+        if (parameter->getValue() != normalised) parameter->setValueNotifyingHost(normalised);
+    }
+}
+
+int MultibandCompressorAudioProcessor::savePreset(const String& name)
+{
+    auto index = presets.save(name, currentPresetValues());
+    if (index >= 0) {
+        currentPreset = index;
+        updateHostDisplay(ChangeDetails().withProgramChanged(true));
+    }
+    return index;
+}
+
+String MultibandCompressorAudioProcessor::getBandName(int band)
+{
+    return numBands == 3 ? bandSuffix(band) : "Band " + String(band + 1);
+}
+
+MultibandCompressorAudioProcessor::ParameterList MultibandCompressorAudioProcessor::createParameterList()
+{
+    ParameterList list;
+    const auto& specs = parameterSpecs();
+
+    for (int i = 0; i < ParameterNames::PARAMETER_COUNT; ++i) {
+        const auto& spec = specs[i];
+        if (!spec.isUsed()) continue;
+
+        switch (spec.kind) {
+            case ParameterKind::value:       list[i] = std::make_unique<APVTSParameterFloat>      (spec.id, spec.name, spec.defaultValue); break;
+            case ParameterKind::toggle:      list[i] = std::make_unique<APVTSParameterBool>       (spec.id, spec.name, spec.defaultValue); break;
+            case ParameterKind::choice:      list[i] = std::make_unique<APVTSParameterChoice>     (spec.id, spec.name, spec.defaultValue); break;
+            case ParameterKind::choiceIndex: list[i] = std::make_unique<APVTSParameterChoiceIndex>(spec.id, spec.name, spec.defaultValue); break;
+        }
+    }
+
+    return list;
+}
+
+// Parameters are added kind by kind, band by band, in the same order as the
+// original 3-band layout so host parameter indices stay put.
+juce::AudioProcessorValueTreeState::ParameterLayout MultibandCompressorAudioProcessor::createParameterLayout()
+{
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+    const auto& specs = parameterSpecs();
+
+    auto add = [&](int index) {
+        const auto& spec = specs[index];
+
+        switch (spec.kind) {
+            case ParameterKind::value:
+                layout.add(std::make_unique<juce::AudioParameterFloat>(
+                    apvtsParameters[index]->id, spec.name, spec.range, spec.defaultValue));
+                break;
+            case ParameterKind::toggle:
+                layout.add(std::make_unique<juce::AudioParameterBool>(
+                    apvtsParameters[index]->id, spec.name, spec.defaultValue >= 0.5f));
+                break;
+            case ParameterKind::choice:
+            case ParameterKind::choiceIndex:
+                layout.add(std::make_unique<juce::AudioParameterChoice>(
+                    apvtsParameters[index]->id, spec.name, spec.choices, static_cast<int>(spec.defaultValue)));
+                break;
+        }
+    };
+
+    for (auto kind : { THRESHOLD, RATIO, ATTACK, RELEASE, BAND_INPUT, BAND_OUTPUT, MUTE })
+        for (int b = 0; b < numBands; ++b) add(kind + b);
+
+    for (int i = 0; i < numBands - 1; ++i) add(CROSSOVER + i);
+
+    add(OUTPUT_ALL);
+    add(INPUT_ALL);
+    add(BYPASS);
+    add(LINK_MODE);
+
+    for (auto kind : { OVERSAMPLING, LOOKAHEAD, DETECTOR, RMS_WINDOW })
+        for (int b = 0; b < numBands; ++b) add(kind + b);
+
+    add(CROSSOVER_MODE);
+
+    for (int b = 0; b < numBands; ++b) add(KNEE + b);
 
     return layout;
 }
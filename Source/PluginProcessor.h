@@ -15,6 +15,7 @@ using namespace juce;
 #include <vector>
 #include <array>
 #include <unordered_map>
+#include <atomic>
 using std::vector;
 using std::array;
 using std::unordered_map;
@@ -23,54 +24,13 @@ using std::unordered_map;
 #include "Multiband.h"
 #include "Utils.h"
 #include "APVTSParameter.h"
-
-enum ParameterNames
-{
-    THRESHOLD_LOW, THRESHOLD_MID, THRESHOLD_HIGH,
-    RATIO_LOW, RATIO_MID, RATIO_HIGH,
-    ATTACK_LOW, ATTACK_MID, ATTACK_HIGH,
-    RELEASE_LOW, RELEASE_MID, RELEASE_HIGH,
-    INPUT_LOW, INPUT_MID, INPUT_HIGH,
-    OUTPUT_LOW, OUTPUT_MID, OUTPUT_HIGH,
-    MUTE_LOW, MUTE_MID, MUTE_HIGH,
-    LOW_MID_CUT, MID_HIGH_CUT,
-    INPUT_ALL, OUTPUT_ALL,
-    BYPASS,
-    PARAMETER_COUNT
-};  
-
-static std::array<std::unique_ptr<IAPVTSParameter>, ParameterNames::PARAMETER_COUNT> apvtsParameters{
-    std::make_unique<APVTSParameterFloat> ("thresholdLow",  "Threshold Low",  0.0f),
-    std::make_unique<APVTSParameterFloat> ("thresholdMid",  "Threshold Mid",  0.0f),
-    std::make_unique<APVTSParameterFloat> ("thresholdHigh", "Threshold High", 0.0f),
-    std::make_unique<APVTSParameterChoice>("ratioLow",      "Ratio Low",      3.0f),
-    std::make_unique<APVTSParameterChoice>("ratioMid",      "Ratio Mid",      3.0f),
-    std::make_unique<APVTSParameterChoice>("ratioHigh",     "Ratio High",     3.0f),
-    std::make_unique<APVTSParameterFloat> ("attackLow",     "Attack Low",     50.0f),
-    std::make_unique<APVTSParameterFloat> ("attackMid",     "Attack Mid",     50.0f),
-    std::make_unique<APVTSParameterFloat> ("attackHigh",    "Attack High",    50.0f),
-    std::make_unique<APVTSParameterFloat> ("releaseLow",    "Release Low",    250.0f),
-    std::make_unique<APVTSParameterFloat> ("releaseMid",    "Release Mid",    250.0f),
-    std::make_unique<APVTSParameterFloat> ("releaseHigh",   "Release High",   250.0f),
-    std::make_unique<APVTSParameterFloat> ("inputLow",      "Input Low",      0.0f),
-    std::make_unique<APVTSParameterFloat> ("inputMid",      "Input Mid",      0.0f),
-    std::make_unique<APVTSParameterFloat> ("inputHigh",     "Input High",     0.0f),
-    std::make_unique<APVTSParameterFloat> ("outputLow",     "Output Low",     0.0f),
-    std::make_unique<APVTSParameterFloat> ("outputMid",     "Output Mid",     0.0f),
-    std::make_unique<APVTSParameterFloat> ("outputHigh",    "Output High",    0.0f),
-    std::make_unique<APVTSParameterBool>  ("muteLow",       "Mute Low",       0.0f),
-    std::make_unique<APVTSParameterBool>  ("muteMid",       "Mute Mid",       0.0f),
-    std::make_unique<APVTSParameterBool>  ("muteHigh",      "Mute High",      0.0f),
-    std::make_unique<APVTSParameterFloat> ("lowMidCut",     "Low/Mid Cut",    700.0f),
-    std::make_unique<APVTSParameterFloat> ("midHighCut",    "Mid/High Cut",   5000.0f),
-    std::make_unique<APVTSParameterFloat> ("inputAll",      "Input",          0.0f),
-    std::make_unique<APVTSParameterFloat> ("outputAll",     "Output",         0.0f),
-    std::make_unique<APVTSParameterBool>  ("bypass",        "Bypass",         0.0f)
-};
+#include "ParameterSpecs.h"
+#include "PresetManager.h"
+#include "Analyzer.h"
 
 class MultibandCompressorAudioProcessor  : 
     public AudioProcessor,
-    private ValueTree::Listener
+    private AudioProcessorParameter::Listener
 {
 public:
     //==============================================================================
@@ -86,6 +46,8 @@ public:
    #endif
 
     void processBlock (AudioBuffer<float>&, MidiBuffer&) override;
+    void processBlock (AudioBuffer<double>&, MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
 
     //==============================================================================
     AudioProcessorEditor* createEditor() override;
@@ -110,21 +72,76 @@ public:
     void getStateInformation (MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
+private:
+    using ParameterList = std::array<std::unique_ptr<IAPVTSParameter>, ParameterNames::PARAMETER_COUNT>;
+
+    // Built from numBands; slots for bands past numBands stay empty.
+    static ParameterList createParameterList();
+
+    // Per instance: each one holds pointers into this processor's apvts.
+    // Must be declared before apvts, which is built from it.
+    ParameterList apvtsParameters{ createParameterList() };
+
+public:
     AudioProcessorValueTreeState apvts;
 
+    // Largest supported bus, 7.1.4.
+    static constexpr int maxChannels = 12;
+
+    SpectrumAnalyzer& getAnalyzer() { return analyzer; }
+    const EngineMeters& getMeters() const { return compressor.getMeters(); }
+
+    // Host parameter behind a ParameterNames entry, or nullptr for slots past
+    // the build's band count.
+    RangedAudioParameter* getDSPParameter(int index) {
+        auto& param = apvtsParameters[index];
+        return param != nullptr ? apvts.getParameter(param->id.getParamID()) : nullptr;
+    }
+
+    // "Low", "Mid" and "High" in the 3-band build, "Band 1" ... otherwise.
+    static String getBandName(int band);
+
+    // Saves the current settings as a preset and selects it. Returns its
+    // program index, or -1.
+    int savePreset(const String& name);
+
 private:
     AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 
-    std::atomic<bool> parametersChanged{ false };
+    // Parameter listeners only flag the changed index; the audio thread reads
+    // the flagged values at the start of the next block.
+    ParameterChanges parameterChanges;
+    std::array<int, ParameterNames::PARAMETER_COUNT> hostIndexToName{};
 
-    void valueTreePropertyChanged(ValueTree&, const Identifier&) override {
-        parametersChanged.store(true);
+    void parameterValueChanged(int parameterIndex, float) override {
+        parameterChanges.mark(hostIndexToName[parameterIndex]);
     }
 
+    void parameterGestureChanged(int, bool) override {}
+
     void updateDSP();
+
+    PresetValues currentPresetValues() const;
+    void applyPreset(const PresetValues& values);
+
+    PresetLibrary presets;
+    int currentPreset{ 0 };
+
+    // Whole parameter sets from state and preset recalls, taken by updateDSP().
+    ParameterStage stagedParameters;
+
+    // Both processBlock overloads; the engine takes either sample type.
+    template <typename SampleType>
+    void process(AudioBuffer<SampleType>& buffer);
     DSPParameters<float> compressorParameters;
 
-    MultibandCompressor compressor;
+    MultibandCompressor<numBands> compressor;
+
+    // Written on the audio thread whenever the settings change.
+    std::atomic<double> tailSeconds{ 0.0 };
+
+    // Fed from processBlock; the FFTs run on its own thread.
+    SpectrumAnalyzer analyzer;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MultibandCompressorAudioProcessor)
 };
@@ -5,7 +5,291 @@
     Created: 13 Sep 2024 1:15:48pm
     Author:  dglaf
 
+    Binary plugin state, the preset library on disk, and the hand-over of a
+    whole parameter set to the audio thread.
+
   ==============================================================================
 */
 
 #pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+#include "DSPParameters.h"
+#include "ParameterSpecs.h"
+
+#define PRESET_MAGIC     0x4f495254     // "TRIO" in a little endian int
+#define PRESET_VERSION   1
+#define PRESET_EXTENSION ".triopreset"
+
+// Host values of every parameter, indexed by ParameterNames: the value, 0 or 1,
+// or the index of the choice, as in ParameterSpec. Unused slots hold 0.
+using PresetValues = std::array<float, PARAMETER_COUNT>;
+
+inline PresetValues defaultPresetValues() {
+    const auto& specs = parameterSpecs();
+    PresetValues values{};
+    for (int i = 0; i < PARAMETER_COUNT; ++i) {
+        if (specs[i].isUsed()) values[i] = specs[i].defaultValue;
+    }
+    return values;
+}
+
+// The engine table for a set of host values; all entries are dirty.
+inline DSPParameters<float> engineParameters(const PresetValues& values) {
+    const auto& specs = parameterSpecs();
+    DSPParameters<float> params;
+    for (int i = 0; i < PARAMETER_COUNT; ++i) {
+        if (specs[i].isUsed()) params.set(i, specs[i].toEngine(values[i]));
+    }
+    return params;
+}
+
+// FNV-1a of the parameter ID. The state stores this instead of the ID, so
+// each entry takes 8 bytes whatever the ID and whatever the band count.
+inline uint32_t parameterKey(const juce::String& id) {
+    uint32_t hash = 2166136261u;
+    for (auto* c = id.toRawUTF8(); *c != 0; ++c) {
+        hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+    }
+    return hash;
+}
+
+// ParameterNames entry of a key, or -1 for parameters this build does not have.
+inline int parameterIndexForKey(uint32_t key) {
+    static const std::unordered_map<uint32_t, int> indices = [] {
+        std::unordered_map<uint32_t, int> map;
+        const auto& specs = parameterSpecs();
+        for (int i = 0; i < PARAMETER_COUNT; ++i) {
+            if (!specs[i].isUsed()) continue;
+            auto inserted = map.emplace(parameterKey(specs[i].id), i).second;
+            jassert(inserted);
+            // two IDs with the same key
+            juce::ignoreUnused(inserted);
+        }
+        return map;
+    }();
+
+    auto found = indices.find(key);
+    return found != indices.end() ? found->second : -1;
+}
+
+// Magic, version and entry count, then a key and a host value per parameter,
+// little endian.
+inline void writePreset(const PresetValues& values, juce::MemoryBlock& destination) {
+    const auto& specs = parameterSpecs();
+    int count = 0;
+    for (auto& spec : specs) count += spec.isUsed() ? 1 : 0;
+
+    destination.reset();
+    juce::MemoryOutputStream out(destination, false);
+    out.writeInt(PRESET_MAGIC);
+    out.writeShort(PRESET_VERSION);
+    out.writeShort(static_cast<short>(count));
+
+    for (int i = 0; i < PARAMETER_COUNT; ++i) {
+        if (!specs[i].isUsed()) continue;
+        out.writeInt(static_cast<int>(parameterKey(specs[i].id)));
+        out.writeFloat(values[i]);
+    }
+}
+
+// False unless data is a preset this version can read. Parameters the preset
+// does not mention keep their values; entries for parameters this build does
+// not have (other band counts, later versions) are skipped.
+inline bool readPreset(const void* data, size_t size, PresetValues& values) {
+    juce::MemoryInputStream in(data, size, false);
+    if (size < 8 || static_cast<uint32_t>(in.readInt()) != PRESET_MAGIC) return false;
+
+    auto version = in.readShort();
+    if (version < 1 || version > PRESET_VERSION) return false;
+
+    auto count = static_cast<uint16_t>(in.readShort());
+    if (in.getNumBytesRemaining() < static_cast<juce::int64>(count) * 8) return false;
+
+    const auto& specs = parameterSpecs();
+    for (int e = 0; e < count; ++e) {
+        auto key = static_cast<uint32_t>(in.readInt());
+        auto value = in.readFloat();
+
+        auto index = parameterIndexForKey(key);
+        if (index >= 0 && std::isfinite(value)) values[index] = specs[index].range.getRange().clipValue(value);
+    }
+    return true;
+}
+
+// Values from the XML state of earlier versions (the APVTS state: one PARAM
+// element with id and value per parameter). Parameters it does not mention
+// keep their values. False unless the root is that state and at least one
+// parameter matched.
+inline bool readPresetXml(const juce::XmlElement& state, PresetValues& values) {
+    if (!state.hasTagName("Parameters")) return false;
+
+    const auto& specs = parameterSpecs();
+    auto matched = false;
+    for (int i = 0; i < PARAMETER_COUNT; ++i) {
+        if (!specs[i].isUsed()) continue;
+        if (auto* param = state.getChildByAttribute("id", specs[i].id)) {
+            values[i] = static_cast<float>(param->getDoubleAttribute("value", values[i]));
+            matched = true;
+        }
+    }
+    return matched;
+}
+
+// Any saved state: the binary preset, the blob copyXmlToBinary() writes (magic
+// number, text size, then the XML as UTF-8), or plain XML text.
+inline bool readAnyPreset(const void* data, size_t size, PresetValues& values) {
+    if (readPreset(data, size, values)) return true;
+
+    constexpr uint32_t magicXmlNumber = 0x21324356;
+    auto* bytes = static_cast<const char*>(data);
+    std::unique_ptr<juce::XmlElement> xml;
+
+    if (size > 8 && juce::ByteOrder::littleEndianInt(bytes) == magicXmlNumber) {
+        auto length = std::min(static_cast<size_t>(juce::ByteOrder::littleEndianInt(bytes + 4)), size - 8);
+        xml = juce::parseXML(juce::String::fromUTF8(bytes + 8, static_cast<int>(length)));
+    }
+    else {
+        xml = juce::parseXML(juce::String::fromUTF8(bytes, static_cast<int>(size)));
+    }
+
+    return xml != nullptr && readPresetXml(*xml, values);
+}
+
+// Presets saved as one file each in a directory. The index only lists names
+// and files, on first use and after each save; a preset's file is read when
+// it is loaded. It backs the host's program list, which some wrappers query
+// off the message thread, so every call takes the lock.
+class PresetLibrary
+{
+    juce::File directory;
+    mutable std::mutex indexLock;
+    mutable juce::Array<juce::File> files;
+    mutable bool scanned{ false };
+
+    // The callers below hold indexLock.
+    void scan() const {
+        if (scanned) return;
+        files = directory.findChildFiles(juce::File::findFiles, false, "*" PRESET_EXTENSION);
+        std::sort(files.begin(), files.end(), [](const juce::File& a, const juce::File& b) {
+            return a.getFileName().compareNatural(b.getFileName()) < 0;
+        });
+        scanned = true;
+    }
+
+    int find(const juce::String& name) const {
+        scan();
+        for (int i = 0; i < files.size(); ++i) {
+            if (files[i].getFileNameWithoutExtension() == name) return i;
+        }
+        return -1;
+    }
+
+public:
+
+    explicit PresetLibrary(const juce::File& presetDirectory = defaultDirectory()) : directory(presetDirectory) {}
+
+    static juce::File defaultDirectory() {
+        return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+            .getChildFile("Trio").getChildFile("Presets");
+    }
+
+    int size() const {
+        std::lock_guard<std::mutex> lock(indexLock);
+        scan();
+        return files.size();
+    }
+
+    juce::String getName(int index) const {
+        std::lock_guard<std::mutex> lock(indexLock);
+        scan();
+        return files[index].getFileNameWithoutExtension();
+    }
+
+    int indexOf(const juce::String& name) const {
+        std::lock_guard<std::mutex> lock(indexLock);
+        return find(name);
+    }
+
+    // Starts from the defaults, so parameters the preset does not mention
+    // are reset.
+    bool load(int index, PresetValues& values) const {
+        juce::File file;
+        {
+            std::lock_guard<std::mutex> lock(indexLock);
+            scan();
+            if (!juce::isPositiveAndBelow(index, files.size())) return false;
+            file = files[index];
+        }
+
+        juce::MemoryBlock data;
+        if (!file.loadFileAsData(data)) return false;
+
+        values = defaultPresetValues();
+        return readAnyPreset(data.getData(), data.getSize(), values);
+    }
+
+    // Replaces a preset of the same name. Returns its index, or -1.
+    int save(const juce::String& name, const PresetValues& values) {
+        juce::MemoryBlock data;
+        writePreset(values, data);
+
+        std::lock_guard<std::mutex> lock(indexLock);
+        if (!directory.createDirectory()) return -1;
+
+        auto file = directory.getChildFile(juce::File::createLegalFileName(name) + PRESET_EXTENSION);
+        if (!file.replaceWithData(data.getData(), data.getSize())) return -1;
+
+        scanned = false;
+        return find(file.getFileNameWithoutExtension());
+    }
+};
+
+// Hands whole parameter sets from other threads to the audio thread: three
+// buffers, one being written, one being read and one in between, whose
+// indices are swapped with a single atomic exchange. The audio thread never
+// waits or allocates, and a set staged before the previous one was taken
+// replaces it.
+class ParameterStage
+{
+    std::array<std::array<float, PARAMETER_COUNT>, 3> buffers{};
+    int writing{ 0 };
+    int reading{ 1 };
+
+    // Index of the buffer in between, with the fresh flag set when it holds
+    // a set the audio thread has not taken yet.
+    static constexpr int fresh = 4;
+    std::atomic<int> between{ 2 };
+
+    std::mutex writeLock;
+
+public:
+
+    // Any thread but the audio thread.
+    void stage(const DSPParameters<float>& params) {
+        std::lock_guard<std::mutex> lock(writeLock);
+        for (int i = 0; i < PARAMETER_COUNT; ++i) buffers[writing][i] = params[i];
+        writing = between.exchange(writing | fresh, std::memory_order_acq_rel) & ~fresh;
+    }
+
+    // Audio thread: the set staged since the last call, or nullptr.
+    const std::array<float, PARAMETER_COUNT>* take() {
+        if ((between.load(std::memory_order_relaxed) & fresh) == 0) return nullptr;
+        reading = between.exchange(reading, std::memory_order_acq_rel) & ~fresh;
+        return &buffers[reading];
+    }
+};
+
+
+#undef PRESET_MAGIC
+#undef PRESET_VERSION
+#undef PRESET_EXTENSION
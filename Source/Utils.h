@@ -3,22 +3,24 @@
 #include <JuceHeader.h>
 #include <cmath>
 
-float linearToDb(float input) {
+inline float linearToDb(float input) {
     return 20.0f * log10f(fabsf(input) + 0.000001f);
 }
 
-float dbToLinear(float input) {
+inline float dbToLinear(float input) {
     return powf(10.0f, input / 20.0f);
 }
 
+#if JUCE_MODULE_AVAILABLE_juce_audio_processors
 template<typename T>
-inline static void castParameter(AudioProcessorValueTreeState& apvts,
-    const ParameterID& id, T& destination)
+inline static void castParameter(juce::AudioProcessorValueTreeState& apvts,
+    const juce::ParameterID& id, T& destination)
 {
     destination = dynamic_cast<T>(apvts.getParameter(id.getParamID()));
     jassert(destination);
     // parameter does not exist or wrong type
 }
+#endif
 
 // Utility functions
 template<typename T>
@@ -35,11 +37,67 @@ inline unsigned int nearestPowerOfTwo(int n) {
     return pow(2, ceil(log(n) / log(2)));
 }
 
+// Zeroth order modified Bessel function of the first kind, for Kaiser windows.
+inline double besselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int i = 1; i < 32; ++i) {
+        term *= (x / (2.0 * i)) * (x / (2.0 * i));
+        sum += term;
+    }
+    return sum;
+}
+
 template<typename T>
 T lerp(T a, T b, T f) {
     return a * (1.0 - f) + b * f;
 }
 
+// SIMD lane packing: the engine runs channels in groups of simdLanes, one
+// channel per lane, so L and R of a stereo bus share every instruction.
+using SIMDFloat = juce::dsp::SIMDRegister<float>;
+constexpr int simdLanes = static_cast<int>(SIMDFloat::SIMDNumElements);
+
+inline float* toFloatPointer(SIMDFloat* p) {
+    return reinterpret_cast<float*>(p);
+}
+
+inline const float* toFloatPointer(const SIMDFloat* p) {
+    return reinterpret_cast<const float*>(p);
+}
+
+inline int numLaneGroups(int numChannels) {
+    return (numChannels + simdLanes - 1) / simdLanes;
+}
+
+// Packs channels [firstChannel, firstChannel + simdLanes) into one register per
+// sample. Lanes past numChannels are zeroed. Double channels are converted on
+// the way, so a double host buffer costs no extra pass.
+template <typename SampleType>
+inline void interleave(const SampleType* const* channels, int firstChannel, int numChannels,
+                       int startSample, SIMDFloat* dest, int numSamples) {
+    auto* out = toFloatPointer(dest);
+    for (int l = 0; l < simdLanes; ++l) {
+        auto ch = firstChannel + l;
+        if (ch < numChannels) {
+            auto* in = channels[ch] + startSample;
+            for (int s = 0; s < numSamples; ++s) out[s * simdLanes + l] = static_cast<float>(in[s]);
+        }
+        else {
+            for (int s = 0; s < numSamples; ++s) out[s * simdLanes + l] = 0.0f;
+        }
+    }
+}
+
+template <typename SampleType>
+inline void deinterleave(const SIMDFloat* source, SampleType* const* channels, int firstChannel,
+                         int numChannels, int startSample, int numSamples) {
+    auto* in = toFloatPointer(source);
+    for (int l = 0; l < simdLanes && firstChannel + l < numChannels; ++l) {
+        auto* out = channels[firstChannel + l] + startSample;
+        for (int s = 0; s < numSamples; ++s) out[s] = static_cast<SampleType>(in[s * simdLanes + l]);
+    }
+}
+
 template<typename T>
 T clamp(T val, T minVal, T maxVal) {
     val = fmin(val, maxVal);
@@ -0,0 +1,457 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Offline batch renderer for the Trio DSP engine.
+
+    Streams audio files through MultibandCompressor on a thread pool, one
+    file per worker. Each file goes through in fixed-size chunks from its
+    reader straight into its writer, so no file is ever held in memory; WAV
+    and AIFF are read through memory-mapped readers. Prints one CSV line
+    per file as it finishes.
+
+    With --segments=N, files are rendered one after another instead, each
+    split into up to N segments that run on the pool at once. Every segment
+    gets a fresh engine that starts early enough to settle to within
+    --tolerance dBFS of an uninterrupted render; --verify renders the file
+    serially as well and reports the largest difference.
+
+    Usage:
+      TrioBatch [--preset=file] [--out=directory] [--suffix=_trio]
+                [--threads=N] [--block=4096]
+                [--segments=N] [--tolerance=-90] [--verify] file|directory ...
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <iostream>
+using std::vector;
+
+#include "../../../Source/Multiband.h"
+#include "../../../Source/ParameterSpecs.h"
+#include "../../../Source/PresetManager.h"
+
+struct BatchSettings
+{
+    DSPParameters<float> params;
+    juce::File outputDirectory;     // next to each input when not set
+    juce::String suffix{ "_trio" };
+    int blockSize{ 4096 };
+
+    int segments{ 1 };
+    float toleranceDb{ -90.0f };
+    bool verify{ false };
+};
+
+struct FileResult
+{
+    juce::File input;
+    juce::File output;
+    int numChannels{ 0 };
+    double sampleRate{ 0.0 };
+    juce::int64 numSamples{ 0 };
+    double wallSeconds{ 0.0 };
+    int segments{ 1 };
+    juce::String maxErrorDb;        // empty unless verified
+    juce::String error;
+};
+
+//==============================================================================
+// A preset is a preset file from the library or a saved plugin state: the
+// binary state, or the XML that earlier versions saved (see PresetManager.h).
+static bool loadPreset(const juce::File& file, PresetValues& values) {
+    juce::MemoryBlock data;
+    return file.loadFileAsData(data) && readAnyPreset(data.getData(), data.getSize(), values);
+}
+
+// WAV and AIFF map the file and page it in as it is read; other formats fall
+// back to a buffered stream reader.
+static std::unique_ptr<juce::AudioFormatReader> openReader(juce::AudioFormatManager& formats, const juce::File& file) {
+    if (auto* format = formats.findFormatForFileExtension(file.getFileExtension())) {
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped(format->createMemoryMappedReader(file));
+        if (mapped != nullptr && mapped->mapEntireFile()) return mapped;
+    }
+
+    return std::unique_ptr<juce::AudioFormatReader>(formats.createReaderFor(file));
+}
+
+// Same format as the output's extension, same rate, channels and metadata as
+// the source, and bitsPerSample or the source's bit depth where the format
+// can write it.
+static std::unique_ptr<juce::AudioFormatWriter> openWriter(juce::AudioFormatManager& formats, const juce::File& file,
+                                                           const juce::AudioFormatReader& reader, int bitsPerSample = 0) {
+    auto* format = formats.findFormatForFileExtension(file.getFileExtension());
+    if (format == nullptr || !format->canDoSampleRate(static_cast<int>(reader.sampleRate))) return nullptr;
+
+    auto depths = format->getPossibleBitDepths();
+    if (bitsPerSample == 0) bitsPerSample = static_cast<int>(reader.bitsPerSample);
+    if (!depths.contains(bitsPerSample)) bitsPerSample = depths.getLast();
+
+    std::unique_ptr<juce::FileOutputStream> stream(file.createOutputStream());
+    if (stream == nullptr || stream->failedToOpen()) return nullptr;
+    stream->setPosition(0);
+    stream->truncate();
+
+    std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(), reader.sampleRate, reader.numChannels,
+                                                                            bitsPerSample, reader.metadataValues, 0));
+    // On success the writer owns the stream.
+    if (writer != nullptr) stream.release();
+    return writer;
+}
+
+//==============================================================================
+static std::unique_ptr<MultibandCompressor<numBands>> createEngine(const juce::AudioFormatReader& reader, const BatchSettings& settings) {
+    auto engine = std::make_unique<MultibandCompressor<numBands>>();
+    engine->prepare(static_cast<float>(reader.sampleRate), settings.blockSize, static_cast<int>(reader.numChannels), settings.params);
+    return engine;
+}
+
+// The engine output over a file from output sample `start` on, a chunk at a
+// time and lined up with the input. The engine runs ahead by its latency and,
+// past the start of the file, starts a pre-roll early so it has settled to
+// within the tolerance by `start`; that output is dropped. Reads past the end
+// of the file are silent.
+class StreamRenderer
+{
+public:
+    StreamRenderer(juce::AudioFormatReader& source, const BatchSettings& settings, juce::int64 start)
+        : reader(source), engine(createEngine(source, settings)),
+          scratch(static_cast<int>(source.numChannels), settings.blockSize) {
+        auto preRoll = start > 0 ? static_cast<juce::int64>(engine->getSettlingSamples(settings.toleranceDb)) : 0;
+        position = std::max<juce::int64>(0, start - preRoll);
+
+        auto skip = start - position + engine->getLatencySamples();
+        while (skip > 0) {
+            auto n = static_cast<int>(std::min<juce::int64>(scratch.getNumSamples(), skip));
+            process(scratch, n);
+            skip -= n;
+        }
+    }
+
+    // The next numSamples of output, into the start of buffer.
+    void next(juce::AudioBuffer<float>& buffer, int numSamples) {
+        process(buffer, numSamples);
+    }
+
+private:
+    void process(juce::AudioBuffer<float>& buffer, int numSamples) {
+        reader.read(&buffer, 0, numSamples, position, true, true);
+        engine->processBlock(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), numSamples);
+        position += numSamples;
+    }
+
+    juce::AudioFormatReader& reader;
+    std::unique_ptr<MultibandCompressor<numBands>> engine;
+    juce::AudioBuffer<float> scratch;
+    juce::int64 position{ 0 };
+};
+
+// Output samples [start, end) of the file.
+static void render(juce::AudioFormatReader& reader, juce::AudioFormatWriter& writer, const BatchSettings& settings,
+                   juce::int64 start, juce::int64 end) {
+    juce::ScopedNoDenormals noDenormals;
+
+    StreamRenderer renderer(reader, settings, start);
+    juce::AudioBuffer<float> buffer(static_cast<int>(reader.numChannels), settings.blockSize);
+
+    for (auto position = start; position < end; position += settings.blockSize) {
+        auto n = static_cast<int>(std::min<juce::int64>(settings.blockSize, end - position));
+        renderer.next(buffer, n);
+        writer.writeFromAudioSampleBuffer(buffer, 0, n);
+    }
+}
+
+// Copies every sample of reader to writer.
+static void append(juce::AudioFormatReader& reader, juce::AudioFormatWriter& writer, int blockSize) {
+    juce::AudioBuffer<float> buffer(static_cast<int>(reader.numChannels), blockSize);
+
+    for (juce::int64 position = 0; position < reader.lengthInSamples; position += blockSize) {
+        auto n = static_cast<int>(std::min<juce::int64>(blockSize, reader.lengthInSamples - position));
+        reader.read(&buffer, 0, n, position, true, true);
+        writer.writeFromAudioSampleBuffer(buffer, 0, n);
+    }
+}
+
+// Largest difference between the segments, in order, and a serial render of
+// the whole file, in dBFS.
+static float compareWithSerial(juce::AudioFormatReader& source, juce::AudioFormatManager& formats,
+                               const vector<juce::File>& parts, const BatchSettings& settings) {
+    juce::ScopedNoDenormals noDenormals;
+
+    StreamRenderer serial(source, settings, 0);
+    auto numChannels = static_cast<int>(source.numChannels);
+    juce::AudioBuffer<float> expected(numChannels, settings.blockSize);
+    juce::AudioBuffer<float> actual(numChannels, settings.blockSize);
+    auto maxError = 0.0f;
+
+    for (auto& part : parts) {
+        auto reader = openReader(formats, part);
+        if (reader == nullptr) return std::numeric_limits<float>::infinity();
+
+        for (juce::int64 position = 0; position < reader->lengthInSamples; position += settings.blockSize) {
+            auto n = static_cast<int>(std::min<juce::int64>(settings.blockSize, reader->lengthInSamples - position));
+            serial.next(expected, n);
+            reader->read(&actual, 0, n, position, true, true);
+
+            for (int ch = 0; ch < numChannels; ++ch) {
+                auto* e = expected.getReadPointer(ch);
+                auto* a = actual.getReadPointer(ch);
+                for (int i = 0; i < n; ++i) maxError = std::max(maxError, std::abs(a[i] - e[i]));
+            }
+        }
+    }
+
+    return juce::Decibels::gainToDecibels(maxError, -300.0f);
+}
+
+static FileResult processFile(const juce::File& input, juce::AudioFormatManager& formats, const BatchSettings& settings) {
+    using Clock = std::chrono::steady_clock;
+
+    FileResult result;
+    result.input = input;
+
+    auto directory = settings.outputDirectory == juce::File() ? input.getParentDirectory() : settings.outputDirectory;
+    result.output = directory.getChildFile(input.getFileNameWithoutExtension() + settings.suffix + input.getFileExtension());
+
+    auto reader = openReader(formats, input);
+    if (reader == nullptr) {
+        result.error = "unreadable";
+        return result;
+    }
+
+    result.numChannels = static_cast<int>(reader->numChannels);
+    result.sampleRate = reader->sampleRate;
+    result.numSamples = reader->lengthInSamples;
+
+    if (result.output == input) {
+        result.error = "output would overwrite input";
+        return result;
+    }
+
+    auto writer = openWriter(formats, result.output, *reader);
+    if (writer == nullptr) {
+        result.error = "unwritable";
+        return result;
+    }
+
+    auto start = Clock::now();
+    render(*reader, *writer, settings, 0, reader->lengthInSamples);
+    writer.reset();
+    result.wallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    return result;
+}
+
+// Splits the file into segments no shorter than their pre-roll, renders them
+// to 32-bit float WAV parts next to the output on the pool, then joins the
+// parts into the output.
+static FileResult processFileInSegments(const juce::File& input, juce::AudioFormatManager& formats,
+                                        const BatchSettings& settings, juce::ThreadPool& pool) {
+    using Clock = std::chrono::steady_clock;
+
+    FileResult result;
+    result.input = input;
+
+    auto directory = settings.outputDirectory == juce::File() ? input.getParentDirectory() : settings.outputDirectory;
+    result.output = directory.getChildFile(input.getFileNameWithoutExtension() + settings.suffix + input.getFileExtension());
+
+    auto reader = openReader(formats, input);
+    if (reader == nullptr) {
+        result.error = "unreadable";
+        return result;
+    }
+
+    auto length = reader->lengthInSamples;
+    result.numChannels = static_cast<int>(reader->numChannels);
+    result.sampleRate = reader->sampleRate;
+    result.numSamples = length;
+
+    if (result.output == input) {
+        result.error = "output would overwrite input";
+        return result;
+    }
+
+    auto writer = openWriter(formats, result.output, *reader);
+    if (writer == nullptr) {
+        result.error = "unwritable";
+        return result;
+    }
+
+    auto preRoll = std::max<juce::int64>(1, createEngine(*reader, settings)->getSettlingSamples(settings.toleranceDb));
+    auto numSegments = static_cast<int>(juce::jlimit<juce::int64>(1, settings.segments, length / preRoll));
+    result.segments = numSegments;
+
+    vector<juce::File> parts;
+    for (int i = 0; i < numSegments; ++i) {
+        parts.push_back(result.output.getSiblingFile(result.output.getFileNameWithoutExtension() + ".part" + juce::String(i) + ".wav"));
+    }
+
+    auto start = Clock::now();
+    std::atomic<int> failedParts{ 0 };
+
+    for (int i = 0; i < numSegments; ++i) {
+        pool.addJob([&, i] {
+            auto segmentReader = openReader(formats, input);
+            auto partWriter = segmentReader != nullptr ? openWriter(formats, parts[i], *segmentReader, 32) : nullptr;
+            if (partWriter == nullptr) {
+                ++failedParts;
+                return;
+            }
+            render(*segmentReader, *partWriter, settings, length * i / numSegments, length * (i + 1) / numSegments);
+        });
+    }
+
+    while (pool.getNumJobs() > 0)
+        juce::Thread::sleep(5);
+
+    if (failedParts == 0) {
+        for (auto& part : parts) {
+            auto partReader = openReader(formats, part);
+            if (partReader == nullptr) {
+                ++failedParts;
+                break;
+            }
+            append(*partReader, *writer, settings.blockSize);
+        }
+    }
+    writer.reset();
+    result.wallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    if (failedParts > 0) {
+        result.error = "unwritable";
+    }
+    else if (settings.verify) {
+        auto maxError = compareWithSerial(*reader, formats, parts, settings);
+        result.maxErrorDb = juce::String(maxError, 1);
+        if (!(maxError <= settings.toleranceDb)) result.error = "mismatch";
+    }
+
+    for (auto& part : parts) part.deleteFile();
+    return result;
+}
+
+//==============================================================================
+static void printCsvHeader() {
+    std::cout << "file,output,channels,sample_rate,audio_seconds,wall_seconds,realtime_factor,segments,max_error_db,status" << std::endl;
+}
+
+static void printCsvRow(const FileResult& r) {
+    auto audioSeconds = r.sampleRate > 0.0 ? r.numSamples / r.sampleRate : 0.0;
+
+    std::cout << r.input.getFullPathName() << ','
+              << r.output.getFullPathName() << ','
+              << r.numChannels << ','
+              << r.sampleRate << ','
+              << audioSeconds << ','
+              << r.wallSeconds << ','
+              << (r.wallSeconds > 0.0 ? audioSeconds / r.wallSeconds : 0.0) << ','
+              << r.segments << ','
+              << r.maxErrorDb << ','
+              << (r.error.isEmpty() ? juce::String("ok") : r.error) << std::endl;
+}
+
+// Files as given, and every audio file directly inside a given directory.
+static vector<juce::File> collectFiles(const juce::ArgumentList& args, const juce::AudioFormatManager& formats) {
+    vector<juce::File> files;
+    auto cwd = juce::File::getCurrentWorkingDirectory();
+
+    for (auto& arg : args.arguments) {
+        if (arg.isOption()) continue;
+
+        auto file = cwd.getChildFile(arg.text);
+        if (file.isDirectory()) {
+            for (auto& child : file.findChildFiles(juce::File::findFiles, false, formats.getWildcardForAllFormats()))
+                files.push_back(child);
+        }
+        else {
+            files.push_back(file);
+        }
+    }
+
+    return files;
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+
+    BatchSettings settings;
+    auto preset = defaultPresetValues();
+
+    if (args.containsOption("--preset")) {
+        if (!loadPreset(juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--preset")), preset)) {
+            std::cerr << "Cannot read preset " << args.getValueForOption("--preset") << std::endl;
+            return 1;
+        }
+    }
+    settings.params = engineParameters(preset);
+    settings.params.clearDirty();
+
+    if (args.containsOption("--out")) {
+        settings.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--out"));
+        settings.outputDirectory.createDirectory();
+    }
+    if (args.containsOption("--suffix"))
+        settings.suffix = args.getValueForOption("--suffix");
+    if (args.containsOption("--block"))
+        settings.blockSize = juce::jmax(1, args.getValueForOption("--block").getIntValue());
+    if (args.containsOption("--segments"))
+        settings.segments = juce::jmax(1, args.getValueForOption("--segments").getIntValue());
+    if (args.containsOption("--tolerance"))
+        settings.toleranceDb = -std::abs(args.getValueForOption("--tolerance").getFloatValue());
+    settings.verify = args.containsOption("--verify");
+
+    const auto numThreads = args.containsOption("--threads") ? juce::jmax(1, args.getValueForOption("--threads").getIntValue())
+                                                             : juce::SystemStats::getNumCpus();
+
+    const auto files = collectFiles(args, formats);
+    if (files.empty()) {
+        std::cerr << "No input files" << std::endl;
+        return 1;
+    }
+
+    printCsvHeader();
+
+    std::mutex printLock;
+    std::atomic<int> failures{ 0 };
+
+    {
+        juce::ThreadPool pool(numThreads);
+
+        if (settings.segments > 1) {
+            for (auto& file : files) {
+                auto result = processFileInSegments(file, formats, settings, pool);
+                if (result.error.isNotEmpty()) ++failures;
+                printCsvRow(result);
+            }
+        }
+        else {
+            for (auto& file : files) {
+                pool.addJob([&, file] {
+                    auto result = processFile(file, formats, settings);
+                    if (result.error.isNotEmpty()) ++failures;
+
+                    std::lock_guard<std::mutex> lock(printLock);
+                    printCsvRow(result);
+                });
+            }
+
+            while (pool.getNumJobs() > 0)
+                juce::Thread::sleep(20);
+        }
+    }
+
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,418 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Headless benchmark for the Trio DSP engine.
+
+    Drives MultibandCompressor::processBlock with synthetic signals over a
+    matrix of sample rates, block sizes and channel counts, and prints the
+    timings as CSV (default) or JSON.
+
+    Usage:
+      TrioBenchmark [--format=csv|json] [--seconds=2]
+                    [--sr=44100,48000,...] [--block=16,32,...]
+                    [--channels=1,2] [--signal=sweep,noise,bursts,silence]
+                    [--link=unlinked,linked,grouped] [--bands=2,3,...,8]
+                    [--oversampling=1,2,4,8] [--lookahead=0,5]
+                    [--crossover=iir,linear] [--muted=0,1]
+                    [--isa=auto,sse2,avx2,avx512]
+
+    --isa forces the engine's kernel set (see Dispatch.h); the isa column
+    shows the set that ran, which is narrower when the CPU lacks the one
+    asked for.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+using std::vector;
+
+#include "../../../Source/Multiband.h"
+
+enum class Signal { sweep, noise, bursts, silence };
+
+static const char* signalName(Signal s) {
+    switch (s) {
+        case Signal::sweep:   return "sweep";
+        case Signal::noise:   return "noise";
+        case Signal::bursts:  return "bursts";
+        case Signal::silence: return "silence";
+    }
+    return "";
+}
+
+struct BenchmarkCase
+{
+    Signal signal{ Signal::noise };
+    double sampleRate{ 44100.0 };
+    int blockSize{ 512 };
+    int numChannels{ 2 };
+    LinkMode linkMode{ LinkMode::unlinked };
+    int numBands{ 3 };
+    int oversampling{ 1 };
+    float lookaheadMs{ 0.0f };
+    CrossoverMode crossoverMode{ CrossoverMode::iir };
+    int mutedBands{ 0 };
+    InstructionSet instructionSet{ InstructionSet::automatic };
+};
+
+struct BenchmarkResult
+{
+    BenchmarkCase benchCase;
+    InstructionSet instructionSet{ InstructionSet::baseline };
+    int numBlocks{ 0 };
+    double nsPerSample{ 0.0 };
+    double realtimeFactor{ 0.0 };
+    double budgetUs{ 0.0 };
+    double p50Us{ 0.0 };
+    double p99Us{ 0.0 };
+    double maxUs{ 0.0 };
+};
+
+//==============================================================================
+// Exponential sine sweep from 20 Hz to 20 kHz (or just below Nyquist) at -6 dBFS.
+static void generateSweep(juce::AudioBuffer<float>& buffer, double sampleRate) {
+    const auto numSamples = buffer.getNumSamples();
+    const double f0 = 20.0;
+    const double f1 = juce::jmin(20000.0, sampleRate * 0.45);
+    const double duration = numSamples / sampleRate;
+    const double k = std::log(f1 / f0);
+
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch) {
+        auto* data = buffer.getWritePointer(ch);
+        const double offset = 0.25 * juce::MathConstants<double>::pi * ch;
+
+        for (int s = 0; s < numSamples; ++s) {
+            auto t = s / sampleRate;
+            auto phase = juce::MathConstants<double>::twoPi * f0 * duration / k * (std::exp(t * k / duration) - 1.0);
+            data[s] = static_cast<float>(0.5 * std::sin(phase + offset));
+        }
+    }
+}
+
+// Uncorrelated white noise per channel at roughly -12 dBFS RMS.
+static void generateNoise(juce::AudioBuffer<float>& buffer) {
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch) {
+        juce::Random random(0x7269 + ch);
+        auto* data = buffer.getWritePointer(ch);
+
+        for (int s = 0; s < buffer.getNumSamples(); ++s)
+            data[s] = (random.nextFloat() * 2.0f - 1.0f) * 0.43f;
+    }
+}
+
+// 5 ms full-scale noise bursts every 250 ms over a -40 dBFS floor, so the
+// detectors keep switching between attack and release.
+static void generateBursts(juce::AudioBuffer<float>& buffer, double sampleRate) {
+    const auto burstLength = static_cast<int>(0.005 * sampleRate);
+    const auto period = static_cast<int>(0.25 * sampleRate);
+
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch) {
+        juce::Random random(0x5eed + ch);
+        auto* data = buffer.getWritePointer(ch);
+
+        for (int s = 0; s < buffer.getNumSamples(); ++s) {
+            auto gain = (s % period) < burstLength ? 1.0f : 0.01f;
+            data[s] = (random.nextFloat() * 2.0f - 1.0f) * gain;
+        }
+    }
+}
+
+static const char* crossoverName(CrossoverMode m) {
+    switch (m) {
+        case CrossoverMode::iir:         return "iir";
+        case CrossoverMode::linearPhase: return "linear";
+    }
+    return "";
+}
+
+static const char* linkName(LinkMode m) {
+    switch (m) {
+        case LinkMode::unlinked: return "unlinked";
+        case LinkMode::linked:   return "linked";
+        case LinkMode::grouped:  return "grouped";
+    }
+    return "";
+}
+
+static void generateSignal(Signal type, juce::AudioBuffer<float>& buffer, double sampleRate) {
+    switch (type) {
+        case Signal::sweep:   generateSweep(buffer, sampleRate); break;
+        case Signal::noise:   generateNoise(buffer); break;
+        case Signal::bursts:  generateBursts(buffer, sampleRate); break;
+        case Signal::silence: buffer.clear(); break;
+    }
+}
+
+//==============================================================================
+// Settings chosen so that every band is compressing for most of the run.
+// oversampling and lookahead apply to every band; the top mutedBands bands
+// are muted.
+static DSPParameters<float> makeParameters(int numBands, LinkMode linkMode, int oversampling, float lookaheadMs,
+                                           CrossoverMode crossoverMode, int mutedBands) {
+    DSPParameters<float> params;
+
+    for (int b = 0; b < numBands; ++b) {
+        params.set(THRESHOLD + b, -24.0f);
+        params.set(RATIO + b, 4.0f);
+        params.set(ATTACK + b, 10.0f);
+        params.set(RELEASE + b, 100.0f);
+        params.set(BAND_INPUT + b, 0.0f);
+        params.set(BAND_OUTPUT + b, 0.0f);
+        params.set(MUTE + b, b >= numBands - mutedBands ? 1.0f : 0.0f);
+        params.set(OVERSAMPLING + b, std::log2(static_cast<float>(oversampling)));
+        params.set(LOOKAHEAD + b, lookaheadMs);
+    }
+
+    for (int i = 0; i < numBands - 1; ++i)
+        params.set(CROSSOVER + i, defaultCrossoverFrequency(numBands, i));
+    params.set(INPUT_ALL, 0.0f);
+    params.set(OUTPUT_ALL, 0.0f);
+    params.set(BYPASS, 0.0f);
+    params.set(LINK_MODE, static_cast<float>(linkMode));
+    params.set(CROSSOVER_MODE, static_cast<float>(crossoverMode));
+
+    return params;
+}
+
+static double percentile(const vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    auto rank = juce::jlimit(1.0, static_cast<double>(sorted.size()), std::ceil(p * sorted.size()));
+    return sorted[static_cast<size_t>(rank) - 1];
+}
+
+template <int NumBands>
+static BenchmarkResult runCase(const BenchmarkCase& c, double seconds) {
+    using Clock = std::chrono::steady_clock;
+
+    const auto numBlocks = juce::jmax(1, static_cast<int>(seconds * c.sampleRate) / c.blockSize);
+    const auto numSamples = numBlocks * c.blockSize;
+    const auto warmupBlocks = juce::jmin(numBlocks, 32);
+
+    juce::AudioBuffer<float> source(c.numChannels, numSamples);
+    generateSignal(c.signal, source, c.sampleRate);
+
+    juce::AudioBuffer<float> block(c.numChannels, c.blockSize);
+    vector<float*> channels(c.numChannels);
+    for (int ch = 0; ch < c.numChannels; ++ch)
+        channels[ch] = block.getWritePointer(ch);
+
+    auto params = makeParameters(NumBands, c.linkMode, c.oversampling, c.lookaheadMs, c.crossoverMode, c.mutedBands);
+    MultibandCompressor<NumBands> compressor;
+    compressor.setInstructionSet(c.instructionSet);
+    compressor.prepare(static_cast<float>(c.sampleRate), c.blockSize, c.numChannels, params);
+
+    vector<double> blockTimes;
+    blockTimes.reserve(numBlocks);
+
+    juce::ScopedNoDenormals noDenormals;
+
+    for (int b = -warmupBlocks; b < numBlocks; ++b) {
+        auto start = (b < 0 ? b + warmupBlocks : b) * c.blockSize;
+        for (int ch = 0; ch < c.numChannels; ++ch)
+            block.copyFrom(ch, 0, source, ch, start, c.blockSize);
+
+        auto t0 = Clock::now();
+        compressor.processBlock(channels.data(), c.numChannels, c.blockSize);
+        auto t1 = Clock::now();
+
+        if (b >= 0)
+            blockTimes.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+    }
+
+    double totalNs = 0.0;
+    for (auto t : blockTimes) totalNs += t;
+
+    std::sort(blockTimes.begin(), blockTimes.end());
+
+    BenchmarkResult result;
+    result.benchCase = c;
+    result.instructionSet = compressor.getInstructionSet();
+    result.numBlocks = numBlocks;
+    result.nsPerSample = totalNs / (static_cast<double>(numSamples) * c.numChannels);
+    result.realtimeFactor = (numSamples / c.sampleRate) / (totalNs * 1.0e-9);
+    result.budgetUs = c.blockSize / c.sampleRate * 1.0e6;
+    result.p50Us = percentile(blockTimes, 0.50) * 1.0e-3;
+    result.p99Us = percentile(blockTimes, 0.99) * 1.0e-3;
+    result.maxUs = blockTimes.back() * 1.0e-3;
+    return result;
+}
+
+// The band count is a template parameter of the engine; this picks the
+// instantiation at run time.
+static BenchmarkResult runCase(const BenchmarkCase& c, double seconds) {
+    switch (c.numBands) {
+        case 2: return runCase<2>(c, seconds);
+        case 3: return runCase<3>(c, seconds);
+        case 4: return runCase<4>(c, seconds);
+        case 5: return runCase<5>(c, seconds);
+        case 6: return runCase<6>(c, seconds);
+        case 7: return runCase<7>(c, seconds);
+        case 8: return runCase<8>(c, seconds);
+    }
+    jassertfalse;
+    return {};
+}
+
+//==============================================================================
+static void printCsvHeader() {
+    std::cout << "signal,sample_rate,block_size,channels,link,bands,oversampling,lookahead_ms,crossover,muted,isa,blocks,ns_per_sample,"
+                 "realtime_factor,budget_us,p50_us,p99_us,max_us" << std::endl;
+}
+
+static void printCsvRow(const BenchmarkResult& r) {
+    std::cout << signalName(r.benchCase.signal) << ','
+              << r.benchCase.sampleRate << ','
+              << r.benchCase.blockSize << ','
+              << r.benchCase.numChannels << ','
+              << linkName(r.benchCase.linkMode) << ','
+              << r.benchCase.numBands << ','
+              << r.benchCase.oversampling << ','
+              << r.benchCase.lookaheadMs << ','
+              << crossoverName(r.benchCase.crossoverMode) << ','
+              << r.benchCase.mutedBands << ','
+              << getInstructionSetName(r.instructionSet) << ','
+              << r.numBlocks << ','
+              << r.nsPerSample << ','
+              << r.realtimeFactor << ','
+              << r.budgetUs << ','
+              << r.p50Us << ','
+              << r.p99Us << ','
+              << r.maxUs << std::endl;
+}
+
+static juce::var toJson(const BenchmarkResult& r) {
+    auto* object = new juce::DynamicObject();
+    object->setProperty("signal", signalName(r.benchCase.signal));
+    object->setProperty("sample_rate", r.benchCase.sampleRate);
+    object->setProperty("block_size", r.benchCase.blockSize);
+    object->setProperty("channels", r.benchCase.numChannels);
+    object->setProperty("link", linkName(r.benchCase.linkMode));
+    object->setProperty("bands", r.benchCase.numBands);
+    object->setProperty("oversampling", r.benchCase.oversampling);
+    object->setProperty("lookahead_ms", r.benchCase.lookaheadMs);
+    object->setProperty("crossover", crossoverName(r.benchCase.crossoverMode));
+    object->setProperty("muted", r.benchCase.mutedBands);
+    object->setProperty("isa", getInstructionSetName(r.instructionSet));
+    object->setProperty("blocks", r.numBlocks);
+    object->setProperty("ns_per_sample", r.nsPerSample);
+    object->setProperty("realtime_factor", r.realtimeFactor);
+    object->setProperty("budget_us", r.budgetUs);
+    object->setProperty("p50_us", r.p50Us);
+    object->setProperty("p99_us", r.p99Us);
+    object->setProperty("max_us", r.maxUs);
+    return juce::var(object);
+}
+
+template <typename T>
+static vector<T> parseList(const juce::ArgumentList& args, const juce::String& option, const vector<T>& defaults) {
+    if (!args.containsOption(option)) return defaults;
+
+    vector<T> values;
+    for (auto& token : juce::StringArray::fromTokens(args.getValueForOption(option), ",", ""))
+        values.push_back(static_cast<T>(token.getDoubleValue()));
+    return values;
+}
+
+// Silence only runs when asked for: the engine skips it once settled, which
+// takes a few seconds of it.
+static vector<Signal> parseSignals(const juce::ArgumentList& args) {
+    if (!args.containsOption("--signal")) return { Signal::sweep, Signal::noise, Signal::bursts };
+
+    vector<Signal> signals;
+    for (auto& token : juce::StringArray::fromTokens(args.getValueForOption("--signal"), ",", ""))
+        for (auto s : { Signal::sweep, Signal::noise, Signal::bursts, Signal::silence })
+            if (token == signalName(s)) signals.push_back(s);
+    return signals;
+}
+
+static vector<LinkMode> parseLinkModes(const juce::ArgumentList& args) {
+    vector<LinkMode> all{ LinkMode::unlinked, LinkMode::linked, LinkMode::grouped };
+    if (!args.containsOption("--link")) return { LinkMode::unlinked };
+
+    vector<LinkMode> modes;
+    for (auto& token : juce::StringArray::fromTokens(args.getValueForOption("--link"), ",", ""))
+        for (auto m : all)
+            if (token == linkName(m)) modes.push_back(m);
+    return modes;
+}
+
+static vector<CrossoverMode> parseCrossoverModes(const juce::ArgumentList& args) {
+    vector<CrossoverMode> all{ CrossoverMode::iir, CrossoverMode::linearPhase };
+    if (!args.containsOption("--crossover")) return { CrossoverMode::iir };
+
+    vector<CrossoverMode> modes;
+    for (auto& token : juce::StringArray::fromTokens(args.getValueForOption("--crossover"), ",", ""))
+        for (auto m : all)
+            if (token == crossoverName(m)) modes.push_back(m);
+    return modes;
+}
+
+static vector<InstructionSet> parseInstructionSets(const juce::ArgumentList& args) {
+    if (!args.containsOption("--isa")) return { InstructionSet::automatic };
+
+    vector<InstructionSet> sets;
+    for (auto& token : juce::StringArray::fromTokens(args.getValueForOption("--isa"), ",", "")) {
+        auto set = instructionSetFromName(token);
+        if (set != InstructionSet::automatic || token == getInstructionSetName(InstructionSet::automatic)) sets.push_back(set);
+    }
+    return sets;
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+
+    const auto json = args.getValueForOption("--format") == "json";
+    const auto seconds = args.containsOption("--seconds") ? args.getValueForOption("--seconds").getDoubleValue() : 2.0;
+
+    const auto sampleRates = parseList<double>(args, "--sr", { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 });
+    const auto blockSizes = parseList<int>(args, "--block", { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 });
+    const auto channelCounts = parseList<int>(args, "--channels", { 1, 2 });
+    const auto signals = parseSignals(args);
+    const auto linkModes = parseLinkModes(args);
+    const auto bandCounts = parseList<int>(args, "--bands", { numBands });
+    const auto oversamplingFactors = parseList<int>(args, "--oversampling", { 1 });
+    const auto lookaheads = parseList<float>(args, "--lookahead", { 0.0f });
+    const auto crossoverModes = parseCrossoverModes(args);
+    const auto mutedCounts = parseList<int>(args, "--muted", { 0 });
+    const auto instructionSets = parseInstructionSets(args);
+
+    if (!json) printCsvHeader();
+
+    juce::Array<juce::var> results;
+
+    for (auto signal : signals)
+        for (auto sampleRate : sampleRates)
+            for (auto blockSize : blockSizes)
+                for (auto numChannels : channelCounts)
+                    for (auto linkMode : linkModes)
+                        for (auto bands : bandCounts)
+                            for (auto factor : oversamplingFactors)
+                                for (auto lookahead : lookaheads)
+                                    for (auto crossoverMode : crossoverModes)
+                                        for (auto muted : mutedCounts)
+                                            for (auto instructionSet : instructionSets) {
+                                                if (sampleRate <= 0.0 || blockSize <= 0 || numChannels <= 0) continue;
+                                                if (bands < 2 || bands > maxBands) continue;
+                                                if (factor != 1 && factor != 2 && factor != 4 && factor != 8) continue;
+                                                if (lookahead < 0.0f || lookahead > 10.0f) continue;
+                                                if (muted < 0 || muted > bands) continue;
+
+                                                auto result = runCase({ signal, sampleRate, blockSize, numChannels, linkMode, bands,
+                                                                        factor, lookahead, crossoverMode, muted, instructionSet }, seconds);
+
+                                                if (json) results.add(toJson(result));
+                                                else printCsvRow(result);
+                                            }
+
+    if (json)
+        std::cout << juce::JSON::toString(juce::var(results)) << std::endl;
+
+    return 0;
+}